@@ -0,0 +1,32 @@
+#!/bin/sh
+# Throughput/latency bench gia sharedmem + parent.
+# Ola rythmizontai apo to environment, px:
+#   BENCH_K="4 64" BENCH_CHURN="0 5" BENCH_LINES=200000 BENCH_FLAGS="-t sem;-t futex" make bench
+
+K_LIST=${BENCH_K:-"4 64"}
+CHURN_LIST=${BENCH_CHURN:-"0 5"}
+LINES=${BENCH_LINES:-200000}
+FLAGS_LIST=${BENCH_FLAGS:-"-t sem;-t futex"}
+TMP=${TMPDIR:-/tmp}/os1_bench.$$
+
+mkdir -p "$TMP" || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+printf "%-6s %-6s %-9s %-24s %12s %10s %10s %10s\n" K churn lines flags msgs/s p50_ns p99_ns p999_ns
+for K in $K_LIST; do
+    for CHURN in $CHURN_LIST; do
+        CMD="$TMP/cmd_${K}_${CHURN}.txt"
+        ./gencmd -k "$K" -n "$LINES" -c "$CHURN" > "$CMD" || exit 1
+        echo "$FLAGS_LIST" | tr ';' '\n' | while read -r FLAGS; do
+            ./sharedmem "$K" > /dev/null || exit 1
+            STATS=$(./parent -s $FLAGS $((K + 1)) "$K" "$CMD" | grep '^STATS')
+            if [ -z "$STATS" ]; then
+                echo "run failed: K=$K churn=$CHURN flags=$FLAGS" >&2
+                exit 1
+            fi
+            # STATS messages=.. seconds=.. msgs_per_sec=.. p50_ns=.. p99_ns=.. p999_ns=..
+            set -- $(echo "$STATS" | sed 's/[a-z0-9_]*=//g')
+            printf "%-6s %-6s %-9s %-24s %12s %10s %10s %10s\n" "$K" "$CHURN" "$LINES" "$FLAGS" "$4" "$5" "$6" "$7"
+        done || exit 1
+    done
+done
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmdfile.h"
+
+// metatrepei ena command file keimenou se CmdRecord, o parent to diavazei xwris parsing
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <command_file> <compiled_file>\n", argv[0]);
+        exit(1);
+    }
+    CmdReader in;
+    if (cmd_open(&in, argv[1]) == -1) {
+        exit(1);
+    }
+    if (in.compiled) {
+        fprintf(stderr, "%s is already compiled\n", argv[1]);
+        exit(1);
+    }
+    FILE *out = fopen(argv[2], "wb");
+    if (!out) {
+        perror("Failed to open compiled file");
+        exit(1);
+    }
+
+    CmdHeader h;
+    memcpy(h.magic, CMD_MAGIC, 4);
+    h.version = CMD_VERSION;
+    h.count = 0;
+    fwrite(&h, sizeof(h), 1, out); // to count grafetai sto telos
+
+    CmdRecord cmd;
+    while (cmd_next(&in, &cmd)) {
+        if (fwrite(&cmd, sizeof(cmd), 1, out) != 1) {
+            perror("write compiled file failed");
+            exit(1);
+        }
+        h.count++;
+    }
+    if (fseek(out, 0, SEEK_SET) == -1 || fwrite(&h, sizeof(h), 1, out) != 1 || fclose(out) == EOF) {
+        perror("write compiled file failed");
+        exit(1);
+    }
+    cmd_close(&in);
+
+    printf("%s: %llu records\n", argv[2], (unsigned long long)h.count);
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cmdfile.h"
+
+int cmd_open(CmdReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Failed to open command file");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat command file failed");
+        close(fd);
+        return -1;
+    }
+    r->size = st.st_size;
+    if (r->size > 0) { // to mmap den dexetai adeio arxeio, tote apla den exei grammes
+        void *data = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("mmap command file failed");
+            close(fd);
+            return -1;
+        }
+        madvise(data, r->size, MADV_SEQUENTIAL); // to diavazoume mia fora apo thn arxh
+        r->data = data;
+    }
+    close(fd);
+
+    if (r->size >= sizeof(CmdHeader) && memcmp(r->data, CMD_MAGIC, 4) == 0) {
+        CmdHeader h;
+        memcpy(&h, r->data, sizeof(h));
+        if (h.version != CMD_VERSION ||
+            (r->size - sizeof(CmdHeader)) / sizeof(CmdRecord) < h.count) {
+            fprintf(stderr, "Compiled command file %s is corrupt or from another version\n", path);
+            cmd_close(r);
+            return -1;
+        }
+        r->compiled = 1;
+        r->count = h.count;
+    }
+    return 0;
+}
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// to epomeno token ws to telos ths grammhs, adeio an den exei allo
+static const char *next_token(const char *p, const char *end, const char **tok_end) {
+    while (p < end && is_blank(*p)) p++;
+    const char *start = p;
+    while (p < end && !is_blank(*p)) p++;
+    *tok_end = p;
+    return start;
+}
+
+// san to atoi/"%d": proairetiko proshmo kai pshfia, 0 an den yparxoun pshfia
+static int parse_int(const char *p, const char *end, int *value) {
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+    }
+    if (p >= end || *p < '0' || *p > '9') return 0;
+    long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+    }
+    *value = neg ? -v : v;
+    return 1;
+}
+
+static int token_is(const char *tok, const char *tok_end, const char *word) {
+    size_t len = strlen(word);
+    return (size_t)(tok_end - tok) == len && memcmp(tok, word, len) == 0;
+}
+
+// mia grammh "timestamp C<n> S|T|...", "timestamp EXIT" h "timestamp C<n> EXIT",
+// me tous idious kanones pou eixe to sscanf("%d %s %s"). Oi entoles tou control lane
+// (KILL, PAUSE, RESUME, CREDITS <k>) prepei na einai oloklhres lekseis
+static void parse_line(const char *p, const char *end, CmdRecord *cmd) {
+    cmd->step = CMD_NO_STEP;
+    cmd->child_index = CMD_NO_CHILD;
+    cmd->opcode = CMD_LINE;
+    cmd->arg = 0;
+
+    const char *t1_end, *t2_end, *t3_end;
+    const char *t1 = next_token(p, end, &t1_end);
+    int timestamp;
+    if (!parse_int(t1, t1_end, &timestamp)) return;
+    const char *t2 = next_token(t1_end, end, &t2_end);
+    if (t2 == t2_end) return;
+    const char *t3 = next_token(t2_end, end, &t3_end);
+    if (t3 == t3_end) { // dyo tokens: mono to "timestamp EXIT" shmainei kati
+        if (token_is(t2, t2_end, "EXIT")) {
+            cmd->step = timestamp;
+            cmd->opcode = CMD_EXIT;
+        }
+        return;
+    }
+    cmd->step = timestamp;
+    if (t2[0] == 'C') {
+        int number = 0;
+        parse_int(t2 + 1, t2_end, &number);
+        cmd->child_index = number - 1; // "C<number>" -> index apo to 0
+    }
+    if (t3[0] == 'S') cmd->opcode = CMD_SPAWN;
+    else if (t3[0] == 'T') cmd->opcode = CMD_TERMINATE;
+    else if (token_is(t3, t3_end, "EXIT")) cmd->opcode = CMD_EXIT;
+    else if (token_is(t3, t3_end, "KILL")) cmd->opcode = CMD_KILL;
+    else if (token_is(t3, t3_end, "PAUSE")) cmd->opcode = CMD_PAUSE;
+    else if (token_is(t3, t3_end, "RESUME")) cmd->opcode = CMD_RESUME;
+    else if (token_is(t3, t3_end, "CREDITS")) {
+        const char *t4_end;
+        const char *t4 = next_token(t3_end, end, &t4_end);
+        if (parse_int(t4, t4_end, &cmd->arg)) cmd->opcode = CMD_CREDITS;
+    }
+}
+
+int cmd_next(CmdReader *r, CmdRecord *cmd) {
+    if (r->compiled) {
+        if (r->pos >= r->count) return 0;
+        memcpy(cmd, r->data + sizeof(CmdHeader) + r->pos * sizeof(CmdRecord), sizeof(CmdRecord));
+        r->pos++;
+        return 1;
+    }
+    if (r->pos >= r->size) return 0;
+    const char *p = r->data + r->pos;
+    const char *end = r->data + r->size;
+    const char *nl = memchr(p, '\n', end - p);
+    if (!nl) nl = end; // teleutaia grammh xwris '\n'
+    parse_line(p, nl, cmd);
+    r->pos = nl - r->data + 1;
+    return 1;
+}
+
+void cmd_close(CmdReader *r) {
+    if (r->data) {
+        munmap((void *)r->data, r->size);
+    }
+    r->data = NULL;
+}
@@ -0,0 +1,54 @@
+#ifndef CMDFILE_H
+#define CMDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ti kanei mia grammh tou command file
+#define CMD_LINE      0   // kamia entolh, o parent apla stelnei mia grammh (px "12 C3 M")
+#define CMD_SPAWN     1
+#define CMD_TERMINATE 2
+#define CMD_EXIT      3
+#define CMD_KILL      4   // "C<n> KILL": termatismos xwris ta mhnymata pou perimenoun
+#define CMD_PAUSE     5   // "C<n> PAUSE"
+#define CMD_RESUME    6   // "C<n> RESUME"
+#define CMD_CREDITS   7   // "C<n> CREDITS <k>": nea credits gia to paidi
+
+#define CMD_NO_STEP  INT32_MIN   // h grammh den eixe timestamp, to current step den allazei
+#define CMD_NO_CHILD INT32_MIN   // h grammh den eixe "C<n>"
+
+// to compiled arxeio: header kai meta ena CmdRecord gia kathe grammh tou keimenou
+#define CMD_MAGIC "OS1C"
+#define CMD_VERSION 2
+
+typedef struct {
+    char magic[4];       // CMD_MAGIC
+    uint32_t version;    // CMD_VERSION
+    uint64_t count;      // posa records akolouthoun
+} CmdHeader;
+
+typedef struct {
+    int32_t step;        // timestamp h CMD_NO_STEP
+    int32_t child_index; // apo 0, h CMD_NO_CHILD
+    uint32_t opcode;     // CMD_*
+    int32_t arg;         // ta credits tou CMD_CREDITS
+} CmdRecord;
+
+// diavazei eite keimeno eite compiled arxeio, to katalavainei apo to magic
+typedef struct {
+    const char *data;    // olo to arxeio, map mia fora
+    size_t size;
+    size_t pos;          // epomeno byte (keimeno) h epomeno record (compiled)
+    int compiled;        // 1 an einai compiled
+    uint64_t count;      // records tou compiled arxeiou
+} CmdReader;
+
+// epistrefei -1 an to arxeio den anoigei h to compiled header einai lathos
+int cmd_open(CmdReader *r, const char *path);
+
+// h epomenh grammh, 0 sto telos tou arxeiou
+int cmd_next(CmdReader *r, CmdRecord *cmd);
+
+void cmd_close(CmdReader *r);
+
+#endif
@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// synthetiko command file gia to bench: K paidia, n grammes, churn% spawn/terminate
+int main(int argc, char *argv[]) {
+    int K = 10;          // posa paidia
+    long lines = 10000;  // poses grammes prin to EXIT
+    int churn = 0;       // pososto grammwn pou einai S h T
+    unsigned seed = 1;   // idio seed, idio arxeio
+    int opt;
+    while ((opt = getopt(argc, argv, "k:n:c:r:")) != -1) {
+        switch (opt) {
+        case 'k': K = atoi(optarg); break;
+        case 'n': lines = atol(optarg); break;
+        case 'c': churn = atoi(optarg); break;
+        case 'r': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: %s [-k children] [-n lines] [-c churn_percent] [-r seed]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (K <= 0 || lines < K || churn < 0 || churn > 100) {
+        fprintf(stderr, "Need K > 0, lines >= K and churn in [0, 100]\n");
+        exit(1);
+    }
+
+    char *active = calloc(K, 1); // poia paidia trexoun
+    if (!active) {
+        perror("calloc failed");
+        exit(1);
+    }
+    srand(seed);
+
+    long step = 1;
+    for (int i = 0; i < K; i++, step++) { // sthn arxh ksekinane ola
+        printf("%ld C%d S\n", step, i + 1);
+        active[i] = 1;
+    }
+    for (; step <= lines; step++) {
+        int i = rand() % K;
+        if (rand() % 100 < churn) {
+            // churn: an trexei to termatizw, alliws to ksekinaw
+            printf("%ld C%d %s\n", step, i + 1, active[i] ? "T" : "S");
+            active[i] = !active[i];
+        } else {
+            printf("%ld C%d M\n", step, i + 1); // aplh grammh, o parent stelnei ena mhnyma
+        }
+    }
+    printf("%ld EXIT\n", step);
+
+    free(active);
+    return 0;
+}
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE   // sched_setaffinity, pthread_attr_setaffinity_np
 #include <stdio.h>              
 #include <stdlib.h> 
 #include <string.h>             
@@ -9,92 +10,1173 @@
 #include <sys/types.h>           
 #include <sys/wait.h>            
 #include <time.h>              
+#include <spawn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
 
-#define SHM_NAME "/shared_memory" 
-#define SEM_PARENT "/sem_parent"
-#define MAX_CHILDREN 100 
-#define MESSAGE_SIZE 256
+extern char **environ;
 
+#include "sharedmem.h"
+#include "worker.h"
+#include "placement.h"
+#include "cmdfile.h"
+#include "textstat.h"
 
+static SharedMemory *shm_ptr = NULL;      // Global pointer-> shared memory structure
+static size_t shm_size = 0;               // megethos tou segment
+static sem_t **child_sems = NULL;         // Array apo semaphores gia kathe  child (K theseis)
+static const char *corpus = NULL;         // to keimeno, map mia fora
+static size_t corpus_size = 0;
+static size_t corpus_pos = 0;             // apo pou ksekinaei h epomenh grammh
+static int pool_size = 0;                 // posoi workers prespawned (-p)
+static int *pool_free = NULL;             // stoiva me ta PoolSlot pou einai akoma parked
+static int pool_free_count = 0;
+static atomic_int *pool_refilled = NULL;  // 1 = o dispatcher evale neo parked worker, to pairnei o parser
+static atomic_int pool_refills;           // posa slots ksanagemisan oi dispatchers
+static int pool_refills_seen = 0;
+static int thread_workers = 0;            // -m thread: ta paidia trexoun san threads mesa ston parent
+static pthread_t *worker_threads = NULL;  // to thread tou kathe paidiou sto thread mode
+static WorkerArgs *worker_args = NULL;    // prepei na zoun oso trexei to thread
+static unsigned child_credits = RING_SLOTS; // -C: max mhnymata se ptisi ana paidi
+static int chunk_lines = 1;               // -l: poses grammes tou corpus paei kathe mhnyma
+static unsigned long replay_scale = 0;    // -T: ns pragmatikou xronou ana timestamp, 0 = oso pio grhgora
+static const char *trace_path = NULL;     // -X: grafw to trace se auto to arxeio sto telos
+static int top_words = 0;                 // -A: ta paidia metrane lekseis, typwnw tis top_words sto EXIT
+static int pin_parent = 0;                // -c: o parent kai oi dispatchers tou trexoun mono se parent_cpus
+static cpu_set_t parent_cpus;
+static long fd_limit = -1;                // to soft RLIMIT_NOFILE, -1 = xwris orio
+
+#define FD_SPARE 16   // fd pou den pairnoun ta pidfd: sem_open, arxeia tou parent
+
+// synolo apo paidia: dense pinakas gia tuxaia epilogh se O(1) kai bitmap gia elegxo se O(1)
 typedef struct {
-    char message[MESSAGE_SIZE];// buffer
-    int child_pids[MAX_CHILDREN];  // pinakas me child PIDs
-    int child_count;  // counter gia to posa paidia exw ftiaksei
-    int child_start_steps[MAX_CHILDREN]; // start time step
-} SharedMemory;
+    int *list;            // ta paidia tou synolou
+    int *pos;             // se poia thesh tou list einai kathe paidi
+    unsigned long *bits;  // 1 an to paidi einai sto synolo
+    int count;
+} IndexSet;
 
-static sem_t *sem_parent = NULL;          // Global pointer -> parent semaphore
-static SharedMemory *shm_ptr = NULL;      // Global pointer-> shared memory structure
-static sem_t* child_sems[MAX_CHILDREN];  // Array apo semaphores gia kathe  child
+static IndexSet active;                   // energa paidia, ta vlepei mono o parser (routing)
+static IndexSet paused;                   // energa paidia se PAUSE, to routing ta prospernaei (yposynolo tou active)
+
+// entoles apo ton parser pros ton dispatcher pou exei to paidi
+#define OP_SPAWN     0
+#define OP_TERMINATE 1
+#define OP_SEND      2
+#define OP_STOP      3   // o dispatcher teleiwse, erxetai to EXIT
+#define OP_KILL      4   // oi ypoloipes pane sto control lane tou paidiou mprosta apo ta mhnymata
+#define OP_PAUSE     5
+#define OP_RESUME    6
+#define OP_CREDITS   7
+
+#define OP_QUEUE_SLOTS 1024   // dunamh tou 2
+
+typedef struct {
+    int type;           // OP_*
+    int child_index;
+    int step;           // start step gia to SPAWN, end step gia to TERMINATE
+    int pool_slot;      // parked worker gia to SPAWN, -1 an den yparxei
+    int arg;            // ta nea credits gia to CREDITS
+    int gen;            // poio S tou index einai (SPAWN)
+    size_t offset;      // h grammh gia to SEND
+    size_t length;
+} Op;
+
+// ena shard tou parent: ta paidia me index % dispatcher_count == id.
+// Xwris -j yparxei mono to dispatchers[0] kai trexei mesa sto main thread.
+typedef struct {
+    int id;
+    IndexSet owned;           // energa paidia tou shard, gia na mazeuei ta ACK tou window
+    long messages_sent;       // posa kanonika mhnymata esteile (gia to -s)
+    long inflight;            // posa kanonika mhnymata den exoun ginei akoma ACK
+    int window;               // to merido tou -w gia auto to shard, 0 = mono to orio ths ouras
+    pthread_t thread;
+    int efd;                  // to ksypnhma tou shard, to idio me to parent_wake[id].efd
+    int epfd;                 // efd, pidfd twn paidiwn kai timerfd
+    int timerfd;              // to deadline tou -T (mono xwris -j)
+    int timer_fired;
+    IndexSet backlogged;      // paidia me entoles pou perimenoun
+    IndexSet draining;        // phran TERMINATE kai den exoun kanei akoma exit
+    IndexSet polled;          // paidia xwris pidfd (EMFILE), to exit tous to vlepei to waitpid
+    long backlog_total;       // oles oi entoles pou perimenoun sto shard
+    // oura SPSC apo ton parser: o parser grafei to head, o dispatcher to tail
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_int consumer_sleeping;  // o dispatcher koimatai sto head
+    atomic_int producer_sleeping;  // o parser koimatai sto tail
+    Op ops[OP_QUEUE_SLOTS];
+} Dispatcher;
+
+#define BACKLOG_MAX 4096      // pio panw o dispatcher stamataei na pairnei entoles
+
+#define EV_WAKE  ((uint64_t)-1)  // to eventfd tou shard sto epoll, ta pidfd exoun to index tou paidiou
+#define EV_TIMER ((uint64_t)-2)
+
+// katastash enos paidiou, thn allazei mono o dispatcher pou to exei
+#define CHILD_IDLE     0
+#define CHILD_RUNNING  1
+#define CHILD_DRAINING 2   // esteila TERMINATE, perimenw to exit
+
+typedef struct {
+    int state;            // CHILD_*
+    int pidfd;            // -1 sto thread mode h an to pidfd_open apetyxe
+    int gen;              // to S pou to ksekinhse
+    int pool_slot;        // to PoolSlot tou worker, -1 an den htan apo to pool
+    atomic_int exited;    // thread mode: to thread teleiwse
+    atomic_int dead_gen;  // to teleutaio S pou pethane h apetyxe, to diavazei o parser
+    Op *backlog;          // entoles pou perimenoun, me th seira tous (dunamh tou 2)
+    unsigned bl_head, bl_tail, bl_cap;
+    int barriers;         // SPAWN kai entoles control sto backlog, oi nees entoles control den ta prospernane
+} ChildState;
+
+static ChildState *child_state = NULL;
+static int *spawn_gen = NULL;             // parser: posa S exei dei kathe index
+static atomic_int deaths;                 // posa paidia vrhkan nekra oi dispatchers
+static int deaths_seen = 0;
+
+static Dispatcher *dispatchers = NULL;
+static int dispatcher_count = 1;
+static int threaded = 0;                  // 1 me -j: parser sto main thread kai dispatcher threads
+
+// politikes epiloghs paidiou gia kathe mhnyma (-r)
+#define ROUTE_RANDOM 0   // tuxaio energo paidi
+#define ROUTE_P2C    1   // power of two choices: to pio adeio apo duo tuxaia
+#define ROUTE_LEAST  2   // to paidi me ta ligotera mhnymata se anamonh
+#define ROUTE_RR     3   // round robin
+#define ROUTE_HASH   4   // hash ths grammhs, h idia grammh paei sto idio paidi
+
+static int routing = ROUTE_RANDOM;
+static unsigned rr_next = 0;              // epomenh thesh tou active_list gia to round robin
 
-static void create_child_sem(int idx) {
+#define BITS_PER_WORD ((int)(8 * sizeof(unsigned long)))
+
+static void set_init(IndexSet *set, int K) {
+    set->list = malloc(K * sizeof(int));
+    set->pos = malloc(K * sizeof(int));
+    set->bits = calloc((K + BITS_PER_WORD - 1) / BITS_PER_WORD, sizeof(unsigned long));
+    set->count = 0;
+    if (!set->list || !set->pos || !set->bits) {
+        perror("malloc failed in parent");
+        exit(1);
+    }
+}
+
+static void set_free(IndexSet *set) {
+    free(set->list);
+    free(set->pos);
+    free(set->bits);
+}
+
+static int set_has(IndexSet *set, int idx) {
+    return (set->bits[idx / BITS_PER_WORD] >> (idx % BITS_PER_WORD)) & 1;
+}
+
+static void set_add(IndexSet *set, int idx) {
+    if (set_has(set, idx)) return;
+    set->bits[idx / BITS_PER_WORD] |= 1UL << (idx % BITS_PER_WORD);
+    set->pos[idx] = set->count;
+    set->list[set->count++] = idx;
+}
+
+static void set_remove(IndexSet *set, int idx) {
+    if (!set_has(set, idx)) return;
+    set->bits[idx / BITS_PER_WORD] &= ~(1UL << (idx % BITS_PER_WORD));
+    int last = set->list[--set->count]; // to teleutaio pianei th thesh tou
+    set->list[set->pos[idx]] = last;
+    set->pos[last] = set->pos[idx];
+}
+
+static int create_child_sem(int idx) {
+    if (child_sems[idx]) {
+        return 0; // ton kratame kai gia ta epomena spawn tou idiou index, ena palio post apla ksypnaei to neo paidi mia fora parapanw
+    }
     char sem_child_name[64];   // Buffer gia to onoma tou semaphore
     snprintf(sem_child_name, sizeof(sem_child_name), "/sem_child_%d", idx); // monadiko onoma gia kathe semaphore
     sem_unlink(sem_child_name);  // unlink
     child_sems[idx] = sem_open(sem_child_name, O_CREAT | O_EXCL, 0666, 0); // arxikopoiw me 0
     if (child_sems[idx] == SEM_FAILED) { 
         perror("sem_open child failed in parent"); //fail
-        exit(1);
+        child_sems[idx] = NULL;
+        return -1;
     }
+    return 0;
 }
 
-static void spawn_child(int child_index, int current_step) { // spawn child gia sigkekrimeno index, an den trexei hdh
-    if (shm_ptr->child_pids[child_index] != 0) {
-        return; // an uparxei PID, tote trexei hdh, den kanw kati
+// kathe paidi krataei ena pidfd ston parent, to soft orio twn fd (syxna 1024) anevainei sto hard
+static void raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == -1) return;
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &rl) == -1) getrlimit(RLIMIT_NOFILE, &rl);
     }
-    create_child_sem(child_index);
-    pid_t pid = fork();
-    if (pid == 0) {  // path tou Child process 
-        char idx_str[10]; // buffer gia to index tou child
-        snprintf(idx_str, sizeof(idx_str), "%d", child_index); // kanw to index string
-        execl("./child", "child", idx_str, (char*)NULL);  // antikathistw to child image me to executable
-        perror("execl failed");    // fail
+    if (rl.rlim_cur != RLIM_INFINITY) fd_limit = rl.rlim_cur;
+}
+
+// posix_spawn (vfork apo mesa) anti gia fork+execl, gia na mhn antigrafei o parent to address space tou
+static pid_t spawn_process(char *const args[]) {
+    pid_t pid;
+    int err = posix_spawn(&pid, "./child", NULL, NULL, args, environ);
+    if (err != 0) {
+        fprintf(stderr, "posix_spawn failed: %s\n", strerror(err));
+        return -1;
+    }
+    return pid;
+}
+
+// neos worker parked sto PoolSlot, perimenei mexri to S
+static int park_worker(int slot_index) {
+    PoolSlot *slot = &shm_pool(shm_ptr)[slot_index];
+    char slot_str[16];
+    snprintf(slot_str, sizeof(slot_str), "%d", slot_index);
+    char *args[] = { "child", "-p", slot_str, NULL };
+    atomic_store(&slot->state, POOL_PARKED);
+    pid_t pid = spawn_process(args);
+    if (pid < 0) {
+        atomic_store(&slot->state, POOL_EMPTY);
+        return -1;
+    }
+    slot->pid = pid;
+    return 0;
+}
+
+// prespawn workers pou perimenoun parked sto PoolSlot tous mexri to S
+static void prespawn_pool(int count) {
+    pool_free = malloc(count * sizeof(int));
+    pool_refilled = calloc(count, sizeof(atomic_int));
+    if (!pool_free || !pool_refilled) {
+        perror("malloc failed in parent");
         exit(1);
-    } else if (pid > 0) {  // path meta to fork
-        shm_ptr->child_pids[child_index] = pid;  // apothikefsi tou PID
-        if (child_index+1 > shm_ptr->child_count) {
-            shm_ptr->child_count = child_index+1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (park_worker(i) == 0) {
+            pool_free[pool_free_count++] = i;
+        }
+    }
+    pool_size = count;
+}
+
+// o worker tou slot teleiwse: o dispatcher vazei neo parked worker, wste to pool na
+// kalyptei kai ta epomena S kai oxi mono ta prwta pool_size
+static void refill_pool(int slot_index) {
+    if (atomic_load(&shm_ptr->shutdown) || park_worker(slot_index) == -1) return;
+    atomic_store(&pool_refilled[slot_index], 1);
+    atomic_fetch_add(&pool_refills, 1);
+}
+
+// parser: ta slots pou ksanagemisan oi dispatchers mpainoun pali sto pool_free
+static void collect_refills(void) {
+    int now = atomic_load(&pool_refills);
+    if (now == pool_refills_seen) return;
+    pool_refills_seen = now;
+    for (int i = 0; i < pool_size; i++) {
+        if (atomic_exchange(&pool_refilled[i], 0)) {
+            pool_free[pool_free_count++] = i;
+        }
+    }
+}
+
+// oi parked workers pou den xreiasthkan kanoun exit
+static void release_pool(void) {
+    PoolSlot *pool = shm_pool(shm_ptr);
+    collect_refills();
+    while (pool_free_count > 0) {
+        PoolSlot *slot = &pool[pool_free[--pool_free_count]];
+        atomic_store(&slot->state, POOL_EXIT);
+        futex_wake(&slot->state, 1);
+        waitpid(slot->pid, NULL, 0);
+        atomic_store(&slot->state, POOL_EMPTY);
+    }
+    free(pool_free);
+    free(pool_refilled);
+}
+
+// vazw to paidi stis CPU tou (-a/-c), 0 = h idia h diergasia meta to fork
+static void place_process(pid_t pid, int child_index) {
+    cpu_set_t set;
+    if (placement_set(child_index, &set) && sched_setaffinity(pid, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity failed for child");
+    }
+}
+
+static void *worker_thread(void *arg) {
+    WorkerArgs *w = arg;
+    run_worker(w);
+    // to thread den exei pidfd, leei mono tou ston dispatcher oti teleiwse
+    atomic_store(&child_state[w->child_index].exited, 1);
+    eventfd_write(dispatchers[w->child_index % dispatcher_count].efd, 1);
+    return NULL;
+}
+
+// thread mode: to paidi ginetai thread, xwris fork/exec/shm_open/mmap/sem_open
+static pid_t spawn_thread(int child_index) {
+    WorkerArgs *w = &worker_args[child_index];
+    w->shm = shm_ptr;
+    w->sem_child = child_sems[child_index]; // NULL sto futex transport
+    w->corpus = corpus;
+    w->corpus_size = corpus_size;
+    w->child_index = child_index;
+    w->thread = 1;
+    atomic_store(&child_state[child_index].exited, 0);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    cpu_set_t set;
+    if (placement_set(child_index, &set)) {
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set); // to thread ksekinaei amesws sth CPU tou
+    }
+    int err = pthread_create(&worker_threads[child_index], &attr, worker_thread, w);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        fprintf(stderr, "pthread_create failed for child %d: %s\n", child_index, strerror(err));
+        return 0;
+    }
+    return getpid(); // to paidi zei mesa ston parent
+}
+
+// ta events tou parent gia to paidi pane sto ring tou dispatcher pou to exei
+static void trace(int child_index, int type, uint64_t arg) {
+    trace_event(shm_ptr, shm_ptr->max_children + child_index % dispatcher_count, type, child_index, arg);
+}
+
+// to paidi den mporei na trexei (to spawn apetyxe h pethane), o parser to vgazei apo to active
+static void report_dead(int child_index, int gen) {
+    atomic_store(&child_state[child_index].dead_gen, gen);
+    atomic_fetch_add(&deaths, 1);
+}
+
+// to pidfd tou paidiou mpainei sto epoll tou dispatcher, etsi vlepoume amesws an kanei exit.
+// An den ginetai (px EMFILE) to paidi trexei kanonika kai o dispatcher kanei poll me waitpid
+static void watch_process(Dispatcher *d, int child_index, pid_t pid) {
+    static atomic_int warned;
+    int pidfd = syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd != -1 && fd_limit > 0 && pidfd >= fd_limit - FD_SPARE) {
+        close(pidfd); // ta teleutaia fd menoun gia to sem_open tou epomenou spawn
+        pidfd = -1;
+        errno = EMFILE;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = child_index };
+    if (pidfd == -1 || epoll_ctl(d->epfd, EPOLL_CTL_ADD, pidfd, &ev) == -1) {
+        if (!atomic_exchange(&warned, 1)) {
+            perror("pidfd_open failed in parent, polling for child exits"); // mia fora, oxi ana paidi
         }
-        shm_ptr->child_start_steps[child_index] = current_step; // katagrafh tou start step tou sugkekrimenou paidiou
+        if (pidfd != -1) close(pidfd);
+        child_state[child_index].pidfd = -1;
+        set_add(&d->polled, child_index);
+        return;
+    }
+    child_state[child_index].pidfd = pidfd;
+}
+
+static void spawn_child(Dispatcher *d, int child_index, int current_step, int pool_slot, int gen) { // spawn child gia sigkekrimeno index, an den trexei hdh
+    ChildState *c = &child_state[child_index];
+    if (c->state != CHILD_IDLE) {
+        return; // trexei hdh, den kanw kati
+    }
+    if (shm_ptr->transport == TRANSPORT_SEM && create_child_sem(child_index) == -1) {
+        report_dead(child_index, gen); // sto futex mode den xreiazetai semaphore
+        return;
+    }
+    shm_ptr->children[child_index].start_step = current_step; // prin to fork, gia na to vrei etoimo to paidi
+    shm_ptr->children[child_index].queue.credits = child_credits;
+
+    char idx_str[10]; // buffer gia to index tou child
+    snprintf(idx_str, sizeof(idx_str), "%d", child_index); // kanw to index string
+    pid_t pid;
+    if (thread_workers) {
+        pid = spawn_thread(child_index);
+    } else if (pool_slot >= 0) {
+        // pool mode: energopoiw enan parked worker, xwris fork sto critical path
+        PoolSlot *slot = &shm_pool(shm_ptr)[pool_slot];
+        place_process(slot->pid, child_index); // prin ton ksypnhsw, na ksekinhsei sth swsth CPU
+        slot->child_index = child_index;
+        atomic_store(&slot->state, POOL_ASSIGNED);
+        futex_wake(&slot->state, 1);
+        pid = slot->pid;
+    } else if (pool_size > 0) {
+        // to pool adeiase, grhgoro spawn
+        char *args[] = { "child", idx_str, NULL };
+        pid = spawn_process(args);
+        if (pid > 0) {
+            place_process(pid, child_index); // to posix_spawn den exei attr gia affinity
+        }
+    } else {
+        pid = fork();
+        if (pid == 0) {  // path tou Child process 
+            place_process(0, child_index); // amesws meta to fork, prin to exec
+            execl("./child", "child", idx_str, (char*)NULL);  // antikathistw to child image me to executable
+            perror("execl failed");    // fail
+            exit(1);
+        } else if (pid < 0) {
+            perror("fork failed");// fail
+        }
+    }
+    if (pid > 0) {  // path meta to fork
+        shm_ptr->children[child_index].pid = pid;  // apothikefsi tou PID
+        trace(child_index, TRACE_SPAWN, pid);
+        c->state = CHILD_RUNNING;
+        c->gen = gen;
+        c->pool_slot = thread_workers ? -1 : pool_slot;
+        if (!thread_workers) {
+            watch_process(d, child_index, pid);
+        }
+        set_add(&d->owned, child_index);
     } else {
-        perror("fork failed");// fail
+        report_dead(child_index, gen);
     }
 }
 
-static void send_message_to_child(int child_index, const char* msg, int is_terminate, int end_step) {
-    if (shm_ptr->child_pids[child_index] == 0) return;   // an den uparxei child se auto to index den kanw tpt
+// ksypnaw to paidi gia neo mhnyma h gia shutdown (force: xtupaw to doorbell kai an den koimatai)
+static void wake_child(int child_index, int force) {
+    ChildQueue *q = &shm_ptr->children[child_index].queue;
+    if (doorbell_mode(shm_ptr) && !force && !atomic_load(&q->child_sleeping)) {
+        return; // to paidi einai ksypnio kai tha vrei to mhnyma prin koimhthei
+    }
+    trace(child_index, TRACE_WAKE, 0);
+    if (shm_ptr->transport == TRANSPORT_FUTEX) {
+        atomic_fetch_add(&q->doorbell, 1);
+        futex_wake(&q->doorbell, 1); // syscall mono an to paidi koimatai
+    } else {
+        sem_post(child_sems[child_index]);  // Signal sto child semaphore gia na diavasei to minima
+    }
+}
+
+// mazeuw ta nea ACK tou paidiou sto inflight tou shard
+static void collect_acks(Dispatcher *d, int child_index) {
+    ChildQueue *q = &shm_ptr->children[child_index].queue;
+    unsigned acked = atomic_load(&q->acked);
+    d->inflight -= acked - q->acked_seen;
+    q->acked_seen = acked;
+}
+
+static void collect_all_acks(Dispatcher *d) {
+    for (int i = 0; i < d->owned.count; i++) {
+        collect_acks(d, d->owned.list[i]);
+    }
+}
 
-    sem_wait(sem_parent); // perimenw to sem parent gia na trexoun tautoxrona
-    if (is_terminate) {
-        char buffer[MESSAGE_SIZE];
-        snprintf(buffer, sizeof(buffer), "TERMINATE:%d", end_step);
-        strncpy(shm_ptr->message, buffer, MESSAGE_SIZE); // mhnuma gia to termination, to vazw kai auto sto shared mem
+// to paidi teleiwse (h pethane): reaping, kai to index einai amesws eleuthero gia neo S
+static void child_exited(Dispatcher *d, int child_index) {
+    ChildState *c = &child_state[child_index];
+    ChildControl *child = &shm_ptr->children[child_index];
+    if (c->state == CHILD_IDLE) return;
+    if (thread_workers) {
+        pthread_join(worker_threads[child_index], NULL);
     } else {
-        strncpy(shm_ptr->message, msg, MESSAGE_SIZE); // vazw to minima sto shared memory
+        if (waitpid(child->pid, NULL, WNOHANG) == 0) return; // den exei teleiwsei akoma
+        if (c->pidfd != -1) close(c->pidfd); // to vgazei kai apo to epoll
+        c->pidfd = -1;
+        set_remove(&d->polled, child_index);
+        if (c->pool_slot >= 0) {
+            refill_pool(c->pool_slot); // to fork ginetai edw, oxi sto epomeno S
+            c->pool_slot = -1;
+        }
+    }
+    collect_acks(d, child_index);
+    trace(child_index, TRACE_EXIT, c->state == CHILD_RUNNING);
+    if (c->state == CHILD_RUNNING) {
+        // pethane xwris TERMINATE: osa emeinan sthn oura tou xanontai
+        fprintf(stderr, "Child C%d (PID %d) exited unexpectedly\n", child_index + 1, child->pid);
+        ChildQueue *q = &child->queue;
+        d->inflight -= q->sent - q->acked_seen;
+        atomic_store(&q->acked, q->sent);
+        q->acked_seen = q->sent;
+        atomic_store(&q->tail, atomic_load(&q->head)); // to epomeno paidi ksekinaei me adeia oura
+        report_dead(child_index, c->gen);
+    }
+    atomic_store(&child->queue.ctrl_tail, atomic_load(&child->queue.ctrl_head)); // entoles pou den diavase
+    child->pid = 0; // markarw to paidi san terminated
+    c->state = CHILD_IDLE;
+    set_remove(&d->owned, child_index);
+    set_remove(&d->draining, child_index);
+}
+
+// oi epomenes chunk_lines grammes tou corpus san ena mhnyma (offset, length), xwris to
+// teleutaio newline. To chunk stamataei sto telos tou corpus kai to epomeno ksanarxizei apo thn arxh
+static void next_corpus_chunk(size_t *offset, size_t *length) {
+    if (corpus_pos >= corpus_size) {
+        corpus_pos = 0; // If we reach EOF, rewind
+    }
+    size_t start = corpus_pos, end = corpus_pos;
+    for (int n = 0; n < chunk_lines && corpus_pos < corpus_size; n++) {
+        const char *line = corpus + corpus_pos;
+        const char *nl = memchr(line, '\n', corpus_size - corpus_pos);
+        size_t len = nl ? (size_t)(nl - line) : corpus_size - corpus_pos;
+        end = corpus_pos + len;
+        corpus_pos += len + (nl ? 1 : 0);
+    }
+    *offset = start;
+    *length = end - start; // ta endiamesa newline menoun mesa, to paidi ta vlepei san mia perioxh tou corpus
+}
+
+// vazw to mhnyma sthn oura tou paidiou, o caller exei hdh elegksei oti xwraei
+static void send_message_to_child(Dispatcher *d, int child_index, size_t offset, size_t length) {
+    ChildQueue *q = &shm_ptr->children[child_index].queue;
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    RingSlot *slot = queue_slot(q, head);
+    slot->offset = offset; // mono o descriptor, ta bytes menoun sto corpus
+    slot->length = length;
+    if (shm_ptr->timing) {
+        slot->enqueue_ns = now_ns();
+    }
+    d->messages_sent++;
+    q->sent++;
+    d->inflight++;
+
+    trace(child_index, TRACE_ENQUEUE, head);
+    atomic_store(&q->head, head + 1); // dhmosieuw to slot sto paidi
+    wake_child(child_index, 0);
+    // den perimenw ACK: to paidi dhmosieuei to acked otan teleiwsei
+}
+
+// entolh sto control lane tou paidiou, epistrefei 0 an to lane einai gemato
+static int send_control(int child_index, int op, int arg) {
+    ChildQueue *q = &shm_ptr->children[child_index].queue;
+    unsigned head = atomic_load_explicit(&q->ctrl_head, memory_order_relaxed);
+    if (head - atomic_load(&q->ctrl_tail) == CTRL_SLOTS) return 0;
+    q->ctrl[head & (CTRL_SLOTS - 1)] = (CtrlSlot){ op, arg };
+    trace(child_index, TRACE_CONTROL, op);
+    atomic_store(&q->ctrl_head, head + 1);
+    wake_child(child_index, 0);
+    return 1;
+}
+
+// FNV-1a ths grammhs gia to ROUTE_HASH
+static unsigned long hash_line(size_t offset, size_t length) {
+    unsigned long h = 14695981039346656037UL;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (unsigned char)corpus[offset + i]) * 1099511628211UL;
+    }
+    return h;
+}
+
+// to paidi exei akoma credits, to vlepei kai o parser apo to shared block
+static int has_credit(int child_index) {
+    ChildControl *child = &shm_ptr->children[child_index];
+    return child_load(child) < child->queue.credits;
+}
+
+// dialegw energo paidi gia th grammh me thn politikh tou -r
+static int route(size_t offset, size_t length) {
+    switch (routing) {
+    case ROUTE_P2C: {
+        int a = active.list[rand() % active.count];
+        int b = active.list[rand() % active.count];
+        return child_load(&shm_ptr->children[b]) < child_load(&shm_ptr->children[a]) ? b : a;
+    }
+    case ROUTE_LEAST: {
+        int best = active.list[0];
+        unsigned best_load = child_load(&shm_ptr->children[best]);
+        for (int i = 1; i < active.count && best_load > 0; i++) {
+            unsigned load = child_load(&shm_ptr->children[active.list[i]]);
+            if (load < best_load) {
+                best = active.list[i];
+                best_load = load;
+            }
+        }
+        return best;
+    }
+    case ROUTE_RR:
+        return active.list[rr_next++ % active.count];
+    case ROUTE_HASH:
+        return active.list[hash_line(offset, length) % active.count];
+    default:
+        return active.list[rand() % active.count];
+    }
+}
+
+// kaleitai mono otan yparxei energo paidi pou den einai se PAUSE. An to paidi ths politikhs einai
+// se PAUSE h den exei credits pairnw to epomeno energo pou exei, wste h grammh na mhn perimenei
+// piso apo ena argo paidi
+static int pick_target(size_t offset, size_t length) {
+    int target = route(offset, length);
+    if (!set_has(&paused, target) && has_credit(target)) return target;
+    int start = active.pos[target];
+    int fallback = set_has(&paused, target) ? -1 : target;
+    for (int i = 1; i < active.count; i++) {
+        int idx = active.list[(start + i) % active.count];
+        if (set_has(&paused, idx)) continue; // den pairnei mhnymata, to backlog tou den tha adeiaze
+        if (has_credit(idx)) return idx;
+        if (fallback < 0) fallback = idx;
+    }
+    return fallback; // ola gemata, h grammh perimenei sto backlog tou dispatcher
+}
+
+// dokimazw na ektelesw thn entolh twra. Epistrefei 0 an prepei na perimenei
+// (gemath oura, gemato window h to palio paidi tou index den exei kanei akoma exit)
+static int try_op(Dispatcher *d, const Op *op) {
+    ChildState *c = &child_state[op->child_index];
+    ChildQueue *q = &shm_ptr->children[op->child_index].queue;
+    switch (op->type) {
+    case OP_SPAWN:
+        if (c->state == CHILD_DRAINING) return 0;
+        spawn_child(d, op->child_index, op->step, op->pool_slot, op->gen);
+        return 1;
+    case OP_TERMINATE: // to paidi teleiwnei osa exei hdh sthn oura kai meta termatizei
+    case OP_KILL:      // to paidi termatizei amesws
+        if (c->state != CHILD_RUNNING) return 1; // den trexei (pethane h to spawn apetyxe)
+        if (!send_control(op->child_index, op->type == OP_KILL ? CTRL_KILL : CTRL_DRAIN, op->step)) return 0;
+        c->state = CHILD_DRAINING; // to reaping ginetai otan kanei exit, xwris na perimenoume edw
+        set_add(&d->draining, op->child_index);
+        return 1;
+    case OP_PAUSE:
+    case OP_RESUME:
+        if (c->state != CHILD_RUNNING) return 1;
+        return send_control(op->child_index, op->type == OP_PAUSE ? CTRL_PAUSE : CTRL_RESUME, 0);
+    case OP_CREDITS:
+        if (c->state != CHILD_RUNNING) return 1;
+        if (!send_control(op->child_index, CTRL_CREDITS, op->arg)) return 0;
+        q->credits = op->arg; // isxyei amesws gia ton parent, to paidi allazei mono to credit_batch
+        return 1;
+    case OP_SEND:
+        if (c->state != CHILD_RUNNING) return 1; // to mhnyma xanetai mazi me to paidi
+        if (d->window > 0 && d->inflight >= d->window) return 0;
+        if (q->sent - atomic_load(&q->acked) >= q->credits) return 0; // xwris credits perimenei to epomeno ACK
+        if (queue_depth(q) == RING_SLOTS) return 0;
+        send_message_to_child(d, op->child_index, op->offset, op->length); // kanoniko minhma
+        return 1;
+    }
+    return 1;
+}
+
+// entoles tou control lane: den perimenoun piso apo ta mhnymata tou backlog
+static int is_control(const Op *op) {
+    return op->type >= OP_KILL;
+}
+
+static int is_barrier(const Op *op) {
+    return op->type == OP_SPAWN || is_control(op);
+}
+
+static void backlog_push(Dispatcher *d, const Op *op) {
+    ChildState *c = &child_state[op->child_index];
+    if (c->bl_tail - c->bl_head == c->bl_cap) { // gemato, diplasiazw kai ta ksanavazw me th seira
+        unsigned cap = c->bl_cap ? c->bl_cap * 2 : 16;
+        Op *ops = malloc(cap * sizeof(Op));
+        if (!ops) {
+            perror("malloc failed in parent");
+            exit(1);
+        }
+        for (unsigned i = 0; i < c->bl_cap; i++) {
+            ops[i] = c->backlog[(c->bl_head + i) & (c->bl_cap - 1)];
+        }
+        free(c->backlog);
+        c->backlog = ops;
+        c->bl_tail = c->bl_cap;
+        c->bl_head = 0;
+        c->bl_cap = cap;
+    }
+    c->backlog[c->bl_tail++ & (c->bl_cap - 1)] = *op;
+    c->barriers += is_barrier(op);
+    set_add(&d->backlogged, op->child_index);
+    d->backlog_total++;
+}
+
+// ektelw osa perimenoun sta backlogs, epistrefei 1 an proxwrhse kati
+static int progress(Dispatcher *d) {
+    int moved = 0;
+    if (thread_workers) {
+        for (int i = d->draining.count - 1; i >= 0; i--) { // ta threads pou teleiwsan
+            int idx = d->draining.list[i];
+            if (atomic_load(&child_state[idx].exited)) {
+                child_exited(d, idx);
+                moved = 1;
+            }
+        }
+    }
+    for (int i = d->polled.count - 1; i >= 0; i--) { // paidia xwris pidfd
+        int idx = d->polled.list[i];
+        child_exited(d, idx);
+        moved |= !set_has(&d->polled, idx);
+    }
+    if (d->backlogged.count == 0) return moved;
+    if (d->window > 0) {
+        collect_all_acks(d); // ta completion counters ta diavazw mono otan kati perimenei
+    }
+    for (int i = 0; i < d->backlogged.count; ) {
+        int idx = d->backlogged.list[i];
+        ChildState *c = &child_state[idx];
+        while (c->bl_head != c->bl_tail && try_op(d, &c->backlog[c->bl_head & (c->bl_cap - 1)])) {
+            c->barriers -= is_barrier(&c->backlog[c->bl_head & (c->bl_cap - 1)]);
+            c->bl_head++;
+            d->backlog_total--;
+            moved = 1;
+        }
+        if (c->bl_head == c->bl_tail) {
+            set_remove(&d->backlogged, idx); // to teleutaio pianei th thesh i
+        } else {
+            i++;
+        }
+    }
+    return moved;
+}
+
+// h entolh ekteleitai amesws an mporei, alliws perimenei sto backlog tou paidiou,
+// etsi ena argo h nekro paidi den stamataei ta ypoloipa
+static void dispatch_op(Dispatcher *d, const Op *op) {
+    ChildState *c = &child_state[op->child_index];
+    if (op->type == OP_SEND && d->window > 0 && d->inflight >= d->window) {
+        collect_all_acks(d);
     }
-    shm_ptr->message[MESSAGE_SIZE - 1] = '\0';// gia na eimai siguros oti termatise
+    // oi entoles control prospernane ta mhnymata pou perimenoun, oxi omws ena SPAWN h allh entolh
+    int may_run = is_control(op) ? c->barriers == 0 : c->bl_head == c->bl_tail;
+    if (!may_run || !try_op(d, op)) {
+        backlog_push(d, op); // h seira ana paidi menei idia
+    }
+}
 
-    sem_post(child_sems[child_index]);  // Signal sto child semaphore gia na diavasei to minima
+static int op_available(Dispatcher *d) {
+    return atomic_load(&d->head) != atomic_load_explicit(&d->tail, memory_order_relaxed);
+}
+
+// ta events pou epestrepse to epoll_wait
+static void handle_events(Dispatcher *d, struct epoll_event *events, int n) {
+    for (int i = 0; i < n; i++) {
+        uint64_t tag = events[i].data.u64, value;
+        if (tag == EV_WAKE) {
+            eventfd_read(d->efd, &value); // mhdenizw to counter
+        } else if (tag == EV_TIMER) {
+            if (read(d->timerfd, &value, sizeof(value)) == sizeof(value)) d->timer_fired = 1;
+        } else {
+            child_exited(d, (int)tag);
+        }
+    }
+}
 
-    if (!is_terminate) {
-        // an einai kanoniko mhnima, perimene gia to ACK tou chil If normal message, wait for child's acknowledgment
-        sem_wait(sem_parent);
-        // release sem_parent afou parw to ACK gia na gurisw sto arxiko state
-        sem_post(sem_parent);
+// koimizw ton dispatcher sto epoll mexri na ginei kati: xwros/ACK apo paidi, nea entolh,
+// exit paidiou (pidfd) h to deadline tou -T (timerfd). accept_ops: ksypnaw kai gia nees entoles
+static void dispatcher_wait(Dispatcher *d, int accept_ops) {
+    ParentWake *pw = &shm_ptr->parent_wake[d->id];
+    atomic_store(&pw->waiting, 1);
+    if (accept_ops) atomic_store(&d->consumer_sleeping, 1);
+    if (progress(d) || (accept_ops && op_available(d))) { // prolave na allaksei kati
+        atomic_store(&pw->waiting, 0);
+        atomic_store(&d->consumer_sleeping, 0);
+        return;
     }
+    struct epoll_event events[32];
+    // me paidia xwris pidfd ksypnaw kathe 1ms gia to waitpid tous
+    int n = epoll_wait(d->epfd, events, 32, d->polled.count > 0 ? 1 : -1);
+    atomic_store(&pw->waiting, 0);
+    atomic_store(&d->consumer_sleeping, 0);
+    handle_events(d, events, n);
+    progress(d);
+}
+
+// xwris -j: o parser den koimatai sto epoll oso diavazei, opote koitaw xwris na perimenw gia
+// paidia pou ekanan exit kai xwro stis oures, wste to index na ksanaginetai S amesws
+static void dispatcher_poll(Dispatcher *d) {
+    struct epoll_event events[32];
+    int n = epoll_wait(d->epfd, events, 32, 0);
+    handle_events(d, events, n);
+    progress(d);
+}
+
+// o parser vazei entolh sthn oura tou dispatcher, perimenei mono an einai gemath
+static void op_push(Dispatcher *d, const Op *op) {
+    unsigned head = atomic_load_explicit(&d->head, memory_order_relaxed);
+    for (;;) {
+        unsigned tail = atomic_load(&d->tail);
+        if (head - tail < OP_QUEUE_SLOTS) break;
+        atomic_store(&d->producer_sleeping, 1);
+        futex_wait(&d->tail, tail); // an o dispatcher prolave na parei entolh, epistrefei amesws
+        atomic_store(&d->producer_sleeping, 0);
+    }
+    d->ops[head & (OP_QUEUE_SLOTS - 1)] = *op;
+    atomic_store(&d->head, head + 1);
+    if (atomic_load(&d->consumer_sleeping)) {
+        eventfd_write(d->efd, 1); // o dispatcher koimatai sto epoll
+    }
+}
+
+static int op_try_pop(Dispatcher *d, Op *op) {
+    unsigned tail = atomic_load_explicit(&d->tail, memory_order_relaxed);
+    if (atomic_load(&d->head) == tail) return 0;
+    *op = d->ops[tail & (OP_QUEUE_SLOTS - 1)];
+    atomic_store(&d->tail, tail + 1);
+    if (atomic_load(&d->producer_sleeping)) {
+        futex_wake(&d->tail, 1);
+    }
+    return 1;
+}
+
+// perimenw mexri na adeiasoun ta backlogs kai na kanoun exit osa phran TERMINATE
+static void dispatcher_flush(Dispatcher *d) {
+    while (d->backlog_total > 0 || d->draining.count > 0) {
+        dispatcher_wait(d, 0);
+    }
+}
+
+static void *dispatcher_thread(void *arg) {
+    Dispatcher *d = arg;
+    Op op;
+    for (;;) {
+        // den pairnw nees entoles oso to backlog einai gemato, o parser perimenei sthn oura
+        while (d->backlog_total < BACKLOG_MAX && op_try_pop(d, &op)) {
+            if (op.type == OP_STOP) {
+                dispatcher_flush(d);
+                return NULL;
+            }
+            dispatch_op(d, &op);
+        }
+        dispatcher_wait(d, d->backlog_total < BACKLOG_MAX);
+    }
+}
+
+// h entolh paei ston dispatcher pou exei to paidi, xwris -j ekteleitai amesws
+static void submit(const Op *op) {
+    if (!threaded) {
+        Dispatcher *d = &dispatchers[0];
+        if (d->backlog_total > 0 || d->draining.count > 0) {
+            dispatcher_poll(d); // exits (pidfd) kai ACK prin thn entolh, oxi mono sto EXIT
+        }
+        dispatch_op(d, op);
+        while (d->backlog_total >= BACKLOG_MAX) {
+            dispatcher_wait(d, 0); // ola ta paidia einai pisw, perimenw na proxwrhsei kapoio
+        }
+        return;
+    }
+    op_push(&dispatchers[op->child_index % dispatcher_count], op);
+}
+
+// ta paidia pou oi dispatchers vrhkan nekra (h den ksekinhsan pote) vgainoun apo to active
+static void collect_deaths(void) {
+    int now = atomic_load(&deaths);
+    if (now == deaths_seen) return;
+    deaths_seen = now;
+    for (int i = active.count - 1; i >= 0; i--) {
+        int idx = active.list[i];
+        if (atomic_load(&child_state[idx].dead_gen) == spawn_gen[idx]) {
+            set_remove(&active, idx); // ena neo S to ksekinaei ksana
+            set_remove(&paused, idx);
+        }
+    }
+}
+
+// S apo ton parser: to paidi mpainei sto active set amesws, to spawn to kanei o dispatcher tou
+static void parse_spawn(int child_index, int current_step) {
+    if (set_has(&active, child_index)) {
+        // isws pethane kai den to exoume dei akoma: xwris -j to pidfd diavazetai mono otan kanw poll
+        if (!threaded) dispatcher_poll(&dispatchers[0]);
+        collect_deaths();
+        if (set_has(&active, child_index)) return; // trexei hdh
+    }
+    Op op = { .type = OP_SPAWN, .child_index = child_index, .step = current_step, .pool_slot = -1,
+              .gen = ++spawn_gen[child_index] };
+    if (pool_free_count == 0) {
+        collect_refills();
+    }
+    if (pool_free_count > 0) {
+        op.pool_slot = pool_free[--pool_free_count];
+    }
+    set_add(&active, child_index);
+    if (child_index+1 > shm_ptr->child_count) { // to grafei mono o parser
+        shm_ptr->child_count = child_index+1;
+    }
+    submit(&op);
+}
+
+// RESUME se paidi pou einai se PAUSE: prospernaei ta mhnymata tou backlog, ara ta mhnymata pou
+// exei hdh ginontai process kai to backlog tou adeiazei
+static void implicit_resume(int child_index) {
+    if (!set_has(&paused, child_index)) return;
+    set_remove(&paused, child_index);
+    Op op = { .type = OP_RESUME, .child_index = child_index };
+    submit(&op);
+}
+
+// T (OP_TERMINATE) h KILL (OP_KILL)
+static void parse_terminate(int child_index, int current_step, int type) {
+    if (!set_has(&active, child_index)) return;
+    if (type == OP_TERMINATE) {
+        implicit_resume(child_index); // to T teleiwnei osa exei, den ta afhnei sthn oura
+    }
+    set_remove(&paused, child_index); // to KILL ta petaei, kai se PAUSE
+    set_remove(&active, child_index);
+    Op op = { .type = type, .child_index = child_index, .step = current_step };
+    submit(&op);
+}
+
+// PAUSE/RESUME/CREDITS se energo paidi
+static void parse_control(int child_index, int type, int arg) {
+    if (!set_has(&active, child_index)) return;
+    if (type == OP_PAUSE) set_add(&paused, child_index);
+    if (type == OP_RESUME) set_remove(&paused, child_index);
+    Op op = { .type = type, .child_index = child_index, .arg = arg };
+    submit(&op);
+}
+
+// prin to EXIT: kathe dispatcher teleiwnei oti exei sthn oura kai sto backlog tou kai stamataei
+static void stop_dispatchers(void) {
+    if (!threaded) {
+        dispatcher_flush(&dispatchers[0]);
+        return;
+    }
+    Op op = { .type = OP_STOP };
+    for (int t = 0; t < dispatcher_count; t++) {
+        op_push(&dispatchers[t], &op);
+    }
+    for (int t = 0; t < dispatcher_count; t++) {
+        pthread_join(dispatchers[t].thread, NULL);
+    }
+    threaded = 0;
+}
+
+// EXIT: shutdown se ola ta paidia mazi mesw tou shared flag kai reaping me th seira pou termatizoun,
+// o xronos einai tou pio argou paidiou kai oxi to athroisma
+static void shutdown_all(int current_step) {
+    while (paused.count > 0) {
+        implicit_resume(paused.list[paused.count - 1]); // to EXIT den afhnei grammes sthn oura
+    }
+    stop_dispatchers(); // meta apo edw ola ta paidia ta xeirizetai to main thread
+    collect_refills();  // kai oi parked workers pou evalan oi dispatchers
+    shm_ptr->shutdown_step = current_step;
+    atomic_store(&shm_ptr->shutdown, 1);
+    for (int t = 0; t < dispatcher_count; t++) {
+        IndexSet *owned = &dispatchers[t].owned;
+        for (int i = 0; i < owned->count; i++) {
+            wake_child(owned->list[i], 1);
+        }
+    }
+    PoolSlot *pool = shm_pool(shm_ptr);
+    for (int i = 0; i < pool_free_count; i++) { // kai oi parked workers pou den xreiasthkan
+        atomic_store(&pool[pool_free[i]].state, POOL_EXIT);
+        futex_wake(&pool[pool_free[i]].state, 1);
+    }
+    pool_free_count = 0;
+
+    siginfo_t info;
+    while (!thread_workers) {
+        if (waitid(P_ALL, 0, &info, WEXITED) == -1) {
+            if (errno == EINTR) continue;
+            break; // ECHILD: den exei meinei kanena paidi
+        }
+    }
+    for (int t = 0; t < dispatcher_count; t++) {
+        Dispatcher *d = &dispatchers[t];
+        while (d->owned.count > 0) {
+            int idx = d->owned.list[d->owned.count - 1];
+            ChildState *c = &child_state[idx];
+            if (thread_workers) {
+                pthread_join(worker_threads[idx], NULL);
+            } else {
+                if (c->pidfd != -1) close(c->pidfd); // to paidi exei hdh ginei reap apo to waitid
+                c->pidfd = -1;
+                set_remove(&d->polled, idx);
+            }
+            shm_ptr->children[idx].pid = 0; // markarw to paidi san terminated
+            c->state = CHILD_IDLE;
+            set_remove(&d->owned, idx);
+        }
+    }
+    while (active.count > 0) {
+        set_remove(&active, active.list[active.count - 1]);
+    }
+}
+
+// p50/p99/p999 apo ena histogramma LAT_BUCKETS
+static void percentiles(const unsigned long *buckets, unsigned long total, unsigned long value[3]) {
+    double pct[] = { 0.50, 0.99, 0.999 };
+    unsigned long seen = 0;
+    int p = 0;
+    value[0] = value[1] = value[2] = 0;
+    for (int b = 0; b < LAT_BUCKETS && p < 3; b++) {
+        seen += buckets[b];
+        while (p < 3 && total > 0 && seen >= pct[p] * total) {
+            value[p++] = lat_bucket_max(b);
+        }
+    }
+}
+
+// synopsh gia to -s: throughput kai percentiles apo ta histogrammata olwn twn paidiwn
+static void print_stats(int K, unsigned long elapsed_ns) {
+    long messages_sent = 0;
+    for (int t = 0; t < dispatcher_count; t++) {
+        messages_sent += dispatchers[t].messages_sent;
+    }
+    unsigned long total = 0;
+    unsigned long buckets[LAT_BUCKETS] = {0};
+    for (int i = 0; i < K; i++) {
+        for (int b = 0; b < LAT_BUCKETS; b++) {
+            buckets[b] += shm_ptr->children[i].latency[b];
+            total += shm_ptr->children[i].latency[b];
+        }
+    }
+    unsigned long value[3];
+    percentiles(buckets, total, value);
+    double secs = elapsed_ns / 1e9;
+    printf("STATS messages=%ld seconds=%.6f msgs_per_sec=%.0f p50_ns=%lu p99_ns=%lu p999_ns=%lu\n",
+           messages_sent, secs, secs > 0 ? messages_sent / secs : 0.0, value[0], value[1], value[2]);
+}
+
+// -X: ta events pou kratane ta rings, ola mazi, to tracedump ta vazei se seira
+static void write_trace(const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror("Failed to open trace file");
+        return;
+    }
+    TraceHeader h;
+    memcpy(h.magic, TRACE_MAGIC, 4);
+    h.version = TRACE_VERSION;
+    h.count = 0;
+    h.dropped = 0;
+    fwrite(&h, sizeof(h), 1, out); // to count grafetai sto telos
+    for (int r = 0; r < shm_ptr->max_children + dispatcher_count; r++) {
+        TraceRing *ring = shm_trace_ring(shm_ptr, r);
+        unsigned long head = atomic_load(&ring->head);
+        unsigned long first = head > shm_ptr->trace_slots ? head - shm_ptr->trace_slots : 0;
+        for (unsigned long i = first; i < head; i++) {
+            fwrite(&ring->events[i & (shm_ptr->trace_slots - 1)], sizeof(TraceEvent), 1, out);
+        }
+        h.count += head - first;
+        h.dropped += first;
+    }
+    if (fseek(out, 0, SEEK_SET) == -1 || fwrite(&h, sizeof(h), 1, out) != 1 || fclose(out) == EOF) {
+        perror("write trace file failed");
+        return;
+    }
+    printf("TRACE %s events=%llu dropped=%llu\n", path, (unsigned long long)h.count, (unsigned long long)h.dropped);
+}
+
+// -A: ola ta paidia exoun teleiwsei, oi pinakes tous enwnontai se enan kai typwnontai oi top_words
+static void print_words(int K) {
+    WordCounts total = { 0 };
+    for (int i = 0; i < K; i++) {
+        word_counts_merge(&total, shm_word_table(shm_ptr, i), shm_ptr->word_slots);
+    }
+    word_counts_report(&total, top_words);
+    word_counts_free(&total);
+}
+
+// -T: perimenw mexri thn apolyth wra ths entolhs, epistrefei poso argoteros ksekinaei o dispatch
+static unsigned long replay_wait(unsigned long deadline_ns) {
+    struct timespec ts = { deadline_ns / 1000000000UL, deadline_ns % 1000000000UL };
+    if (!threaded) {
+        // xwris -j o dispatcher einai to main thread: perimenei sto epoll me to timerfd
+        // kai synexizei ta backlogs kai to reaping mexri to deadline
+        Dispatcher *d = &dispatchers[0];
+        if (now_ns() < deadline_ns) {
+            struct itimerspec its = { .it_value = ts };
+            d->timer_fired = 0;
+            timerfd_settime(d->timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+            while (!d->timer_fired) {
+                dispatcher_wait(d, 0);
+            }
+        }
+    } else {
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+            // ksanakoimamai mexri to idio deadline
+        }
+    }
+    unsigned long now = now_ns();
+    return now > deadline_ns ? now - deadline_ns : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t sem|futex] [-p pool_size] [-s] [-b] [-w window] [-j threads]\n"
+                    "       [-r random|p2c|least|rr|hash] [-m process|thread]\n"
+                    "       [-c parent_cpus] [-a none|spread|pack] [-l lines_per_message]\n"
+                    "       [-C credits] [-T ns_per_step] [-X trace_file] [-A top_words]\n"
+                    "       <M> <K> <command_file>\n", prog);
+    exit(1);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 4) { // cmnd line args
-        fprintf(stderr, "Usage: %s <M> <K> <command_file>\n", argv[0]);
-        exit(1);
+    int transport = TRANSPORT_SEM; // default oi named semaphores
+    int pool = 0; // posoi workers na ginoun prespawn, 0 = xwris pool
+    int timing = 0; // -s: metrame latency kai typwnoume STATS sto telos
+    int batch = 0;  // -b: ta paidia adeiazoun olh thn oura se kathe ksypnhma
+    int window = 0; // max mhnymata se ptisi se ola ta paidia (-w), 0 = mono to orio ths ouras
+    int placement = PLACE_NONE; // -a: pou mpainoun ta paidia
+    int opt;
+    while ((opt = getopt(argc, argv, "t:p:sr:bw:j:m:c:a:l:C:T:X:A:")) != -1) {
+        switch (opt) {
+        case 't':
+            if (strcmp(optarg, "sem") == 0) transport = TRANSPORT_SEM;
+            else if (strcmp(optarg, "futex") == 0) transport = TRANSPORT_FUTEX;
+            else usage(argv[0]);
+            break;
+        case 'p':
+            pool = atoi(optarg);
+            if (pool < 0) usage(argv[0]);
+            break;
+        case 's':
+            timing = 1;
+            break;
+        case 'b':
+            batch = 1;
+            break;
+        case 'w':
+            window = atoi(optarg); // 1 = to palio stop-and-wait
+            if (window < 0) usage(argv[0]);
+            break;
+        case 'j':
+            dispatcher_count = atoi(optarg);
+            if (dispatcher_count < 1 || dispatcher_count > MAX_DISPATCHERS) usage(argv[0]);
+            threaded = 1;
+            break;
+        case 'm':
+            if (strcmp(optarg, "process") == 0) thread_workers = 0;
+            else if (strcmp(optarg, "thread") == 0) thread_workers = 1;
+            else usage(argv[0]);
+            break;
+        case 'c':
+            if (parse_cpu_list(optarg, &parent_cpus) == -1) usage(argv[0]);
+            pin_parent = 1;
+            break;
+        case 'a':
+            if (strcmp(optarg, "none") == 0) placement = PLACE_NONE;
+            else if (strcmp(optarg, "spread") == 0) placement = PLACE_SPREAD;
+            else if (strcmp(optarg, "pack") == 0) placement = PLACE_PACK;
+            else usage(argv[0]);
+            break;
+        case 'C':
+            child_credits = atoi(optarg);
+            if ((int)child_credits < 1) usage(argv[0]);
+            break;
+        case 'X':
+            trace_path = optarg;
+            break;
+        case 'A':
+            top_words = atoi(optarg);
+            if (top_words < 1) usage(argv[0]);
+            break;
+        case 'l':
+            chunk_lines = atoi(optarg);
+            if (chunk_lines < 1) usage(argv[0]);
+            break;
+        case 'T':
+            replay_scale = strtoul(optarg, NULL, 10);
+            if (replay_scale == 0) usage(argv[0]);
+            break;
+        case 'r':
+            if (strcmp(optarg, "random") == 0) routing = ROUTE_RANDOM;
+            else if (strcmp(optarg, "p2c") == 0) routing = ROUTE_P2C;
+            else if (strcmp(optarg, "least") == 0) routing = ROUTE_LEAST;
+            else if (strcmp(optarg, "rr") == 0) routing = ROUTE_RR;
+            else if (strcmp(optarg, "hash") == 0) routing = ROUTE_HASH;
+            else usage(argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+        }
     }
-    int M = atoi(argv[1]);
-    int K = atoi(argv[2]);
-    char *command_file_name = argv[3]; // Command file name
+    if (argc - optind < 3) { // cmnd line args
+        usage(argv[0]);
+    }
+    int M = atoi(argv[optind]);
+    int K = atoi(argv[optind + 1]);
+    char *command_file_name = argv[optind + 2]; // Command file name
 
-    if (K > MAX_CHILDREN) { // elegxos gia to K
-        fprintf(stderr, "K exceeds MAX_CHILDREN limit.\n");
+    if (window > 0 && window < dispatcher_count) {
+        // kathe shard xreiazetai toulaxiston ena mhnyma, alliws to synolo tha perna to -w
+        fprintf(stderr, "The window (-w %d) must be at least the number of threads (-j %d)\n",
+                window, dispatcher_count);
         exit(1);
     }
 
@@ -103,152 +1185,237 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    int shm_fd = shm_open(SHM_NAME, O_RDWR, 0666); // anoigw to shared memory
-    if (shm_fd == -1) {
-        perror("shm_open failed in parent");
+    // anoigw kai kanw map to shared memory, to megethos to vriskw apo to segment
+    shm_ptr = shm_attach("parent", &shm_size, PROT_READ | PROT_WRITE);
+    if (!shm_ptr) {
         exit(1);
     }
 
-    // map me to shared memory
-    shm_ptr = mmap(NULL, sizeof(SharedMemory), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    if (shm_ptr == MAP_FAILED) {
-        perror("mmap failed in parent");
+    if (K > shm_ptr->max_children) { // elegxos gia to K
+        fprintf(stderr, "K exceeds the %d children of the shared memory, run ./sharedmem %d\n",
+                shm_ptr->max_children, K);
         exit(1);
     }
-
-    // Open the parent semaphore (should have been created by sharedmem)
-    sem_parent = sem_open(SEM_PARENT, 0);
-    if (sem_parent == SEM_FAILED) {
-        perror("sem_open parent failed in parent");
+    if (pool > 0 && thread_workers) {
+        fprintf(stderr, "The worker pool (-p) is only for process workers\n");
+        exit(1);
+    }
+    if (pool > shm_ptr->max_children) {
+        fprintf(stderr, "Pool size exceeds the %d slots of the shared memory\n", shm_ptr->max_children);
         exit(1);
     }
 
+    shm_ptr->transport = transport; // to diavazoun ta paidia otan ksekinane
+    shm_ptr->timing = timing;
+    if (trace_path) {
+        if (shm_ptr->trace_slots == 0) {
+            fprintf(stderr, "Tracing (-X) needs trace rings in the shared memory, run ./sharedmem -E <events>\n");
+            exit(1);
+        }
+        for (int r = 0; r < shm_ptr->max_children + MAX_DISPATCHERS; r++) {
+            atomic_store(&shm_trace_ring(shm_ptr, r)->head, 0);
+        }
+    }
+    shm_ptr->tracing = trace_path != NULL; // prin ksekinhsei opoiodhpote paidi
+    if (top_words > 0) {
+        if (shm_ptr->word_slots == 0) {
+            fprintf(stderr, "Word counts (-A) need word tables in the shared memory, run ./sharedmem -W <slots>\n");
+            exit(1);
+        }
+        for (int i = 0; i < K; i++) {
+            memset(shm_word_table(shm_ptr, i), 0, word_table_size(shm_ptr->word_slots));
+        }
+    }
+    shm_ptr->analytics = top_words > 0;
+    shm_ptr->batch = batch;
+    shm_ptr->dispatchers = dispatcher_count; // prin ksekinhsei opoiodhpote paidi
+
     // pinakas me shmaioforoi paidiwn
+    child_sems = calloc(K, sizeof(sem_t *));
+    dispatchers = calloc(dispatcher_count, sizeof(Dispatcher));
+    worker_threads = calloc(K, sizeof(pthread_t));
+    worker_args = calloc(K, sizeof(WorkerArgs));
+    child_state = calloc(K, sizeof(ChildState));
+    spawn_gen = calloc(K, sizeof(int));
+    if (!child_sems || !dispatchers || !worker_threads || !worker_args || !child_state || !spawn_gen) {
+        perror("malloc failed in parent");
+        exit(1);
+    }
+    set_init(&active, K);
+    set_init(&paused, K);
     for (int i = 0; i < K; i++) {
-        child_sems[i] = NULL;
+        child_state[i].pidfd = -1;
+        child_state[i].pool_slot = -1;
+        atomic_store(&child_state[i].dead_gen, -1);
+    }
+    for (int t = 0; t < dispatcher_count; t++) {
+        Dispatcher *d = &dispatchers[t];
+        d->id = t;
+        set_init(&d->owned, K);
+        set_init(&d->backlogged, K);
+        set_init(&d->draining, K);
+        set_init(&d->polled, K);
+        // to eventfd den einai CLOEXEC: to klhronomoun ola ta paidia, kai tou pool, ara ftiaxnetai prin
+        d->efd = eventfd(0, EFD_NONBLOCK);
+        d->epfd = epoll_create1(EPOLL_CLOEXEC);
+        d->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct epoll_event wake = { .events = EPOLLIN, .data.u64 = EV_WAKE };
+        struct epoll_event timer = { .events = EPOLLIN, .data.u64 = EV_TIMER };
+        if (d->efd == -1 || d->epfd == -1 || d->timerfd == -1 ||
+            epoll_ctl(d->epfd, EPOLL_CTL_ADD, d->efd, &wake) == -1 ||
+            epoll_ctl(d->epfd, EPOLL_CTL_ADD, d->timerfd, &timer) == -1) {
+            perror("epoll setup failed in parent");
+            exit(1);
+        }
+        shm_ptr->parent_wake[t].efd = d->efd;
+        if (window > 0) {
+            // to window moirazetai sta shards, kathena mazeuei mono ta ACK twn paidiwn tou.
+            // To ypoloipo paei ena ena sta prwta shards, to athroisma einai akrivws to -w
+            dispatchers[t].window = window / dispatcher_count + (t < window % dispatcher_count);
+        }
     }
 
-    // arxeio config
-    FILE *command_file = fopen(command_file_name, "r");
-    if (!command_file) {
-        perror("Failed to open command file");
+    // arxeio config, keimeno h compiled apo to cmdcompile
+    CmdReader commands;
+    if (cmd_open(&commands, command_file_name) == -1) {
         exit(1);
     }
 
-    // arxeio me keimeno
-    FILE *message_file = fopen("mobydick.txt", "r");
-    if (!message_file) {
-        perror("Failed to open mobydick.txt");
+    // arxeio me keimeno, map mia fora kai to path paei sta paidia
+    if (realpath(CORPUS_FILE, shm_ptr->corpus_path) == NULL) {
+        perror("Failed to open " CORPUS_FILE);
+        exit(1);
+    }
+    corpus = map_corpus(shm_ptr->corpus_path, &corpus_size);
+    if (!corpus) {
         exit(1);
     }
+    // h topologia diavazetai me th mask pou mas edwse to shell, prin pinned o parent
+    placement_init(placement, pin_parent ? &parent_cpus : NULL);
+    if (pin_parent && sched_setaffinity(0, sizeof(parent_cpus), &parent_cpus) == -1) {
+        perror("sched_setaffinity failed for parent");
+        exit(1);
+    }
+    raise_fd_limit(); // prin ksekinhsei opoiodhpote paidi
+    if (pool > 0) {
+        // ola ta akriva vhmata ginontai edw, prin diavasoume entoles
+        if (transport == TRANSPORT_SEM) {
+            for (int i = 0; i < K; i++) {
+                if (create_child_sem(i) == -1) exit(1); // den trexei akoma kanena paidi
+            }
+        }
+        prespawn_pool(pool);
+    }
+
+    unsigned long start_ns = now_ns();
+    int parent_cpu = -1; // me -c kathe dispatcher pairnei th dikh tou CPU apo th lista, kuklika
+    for (int t = 0; threaded && t < dispatcher_count; t++) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (pin_parent) {
+            do {
+                parent_cpu = (parent_cpu + 1) % CPU_SETSIZE;
+            } while (!CPU_ISSET(parent_cpu, &parent_cpus));
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(parent_cpu, &one);
+            pthread_attr_setaffinity_np(&attr, sizeof(one), &one);
+        }
+        if (pthread_create(&dispatchers[t].thread, &attr, dispatcher_thread, &dispatchers[t]) != 0) {
+            perror("pthread_create failed");
+            exit(1);
+        }
+        pthread_attr_destroy(&attr);
+    }
     srand(time(NULL));  // epilogh tuxaiou paidiou
-    char line[256];     // buffer
     int running = 1;    // metavliti flag gia na kserw an trexw akoma h oxi 
     int current_step = 0; // timestampo apo ta commands
+    CmdRecord cmd;
+    unsigned long replay_start = now_ns();  // -T: to timestamp 0 antistoixei se auth th stigmh
+    unsigned long lag_buckets[LAT_BUCKETS] = {0};
+    unsigned long lag_count = 0, lag_max = 0;
     // diavazw ews otou teleiwsoun oi grammes h ean lavw mhnyma na stamatisw 
-    while (running && fgets(line, sizeof(line), command_file)) {
-        int timestamp;
-        char process_label[32], command[32];
-        int n = sscanf(line, "%d %s %s", &timestamp, process_label, command); // parse grammwn
-
-        if (n == 2 && strcmp(process_label, "EXIT") == 0) {
-            //  an phra "timestamp EXIT"
-            current_step = timestamp;
-            //terminate gia ola ta paidia procesces
-            for (int i = 0; i < shm_ptr->child_count; i++) {
-                if (shm_ptr->child_pids[i] != 0) {
-                    send_message_to_child(i, NULL, 1, current_step);  //TERMINATE
-                    waitpid(shm_ptr->child_pids[i], NULL, 0); // perimenw na kanei exit
-                    shm_ptr->child_pids[i] = 0; // markarw to paidi san terminated
-                }
+    while (running && cmd_next(&commands, &cmd)) {
+        if (cmd.step != CMD_NO_STEP) {
+            current_step = cmd.step;
+            if (replay_scale > 0) {
+                // h entolh ekteleitai sto timestamp * scale, oxi molis th diavasoume
+                long long offset = (long long)cmd.step * (long long)replay_scale;
+                unsigned long lag = replay_wait(offset > 0 ? replay_start + offset : replay_start);
+                lag_buckets[lat_bucket(lag)]++;
+                lag_count++;
+                if (lag > lag_max) lag_max = lag;
             }
-            running = 0; // afou phra exit, stop
-        } else if (n == 3) {
-            current_step = timestamp;
-            int child_index = -1;
-            if (process_label[0] == 'C') { // an ksekinaei me C, einai child 
-                child_index = atoi(&process_label[1]) - 1; // metatrepw "C<number>" se index(ksekinontas apo to 0)
-                if (child_index < 0 || child_index >= K) {
-                    fprintf(stderr, " Invalid child index %d\n", child_index);
-                    continue;
-                }
-            }
-            if (command[0] == 'S') {
+        }
+        collect_deaths(); // meta to -T wait: osa pethanan oso perimename
+        if (cmd.child_index != CMD_NO_CHILD && (cmd.child_index < 0 || cmd.child_index >= K)) {
+            fprintf(stderr, " Invalid child index %d\n", cmd.child_index);
+            continue;
+        }
+        if (cmd.opcode == CMD_EXIT) {
+            shutdown_all(current_step); // exit, ara termatizw ola ta paidia
+            running = 0; // stamataw
+        } else if (cmd.child_index != CMD_NO_CHILD) {
+            if (cmd.opcode == CMD_SPAWN) {
                 // S: SPAWN ena neo chiild, an den to exw kanei hdh
-                spawn_child(child_index, current_step);
-            } else if (command[0] == 'T') {
+                parse_spawn(cmd.child_index, current_step);
+            } else if (cmd.opcode == CMD_TERMINATE) {
                 // T: TERMINATE  ena sugkekrikmeno child
-                if (shm_ptr->child_pids[child_index] != 0) {
-                    send_message_to_child(child_index, NULL, 1, current_step); // terminate chilld
-                    waitpid(shm_ptr->child_pids[child_index], NULL, 0);  // perimenw to paidi na termatisei
-                    shm_ptr->child_pids[child_index] = 0; // markarw san terminated
-                }
-            } else if (strcmp(command, "EXIT") == 0) {
-                // exit, ara termatizw ola ta paidia
-                for (int i = 0; i < shm_ptr->child_count; i++) {
-                    if (shm_ptr->child_pids[i] != 0) {
-                        send_message_to_child(i, NULL, 1, current_step);
-                        waitpid(shm_ptr->child_pids[i], NULL, 0);
-                        shm_ptr->child_pids[i] = 0;
-                    }
-                }
-                running = 0; // stamataw
-            }
-        } else {
-            // an to mhnyma pou phra den einai sto format tou mhnymatos pou perimenw (px 21 C3 S), elegxw an einai exit
-            int timestamp2;
-            char cmd_only[32];
-            if (sscanf(line, "%d %s", &timestamp2, cmd_only) == 2 && strcmp(cmd_only, "EXIT") == 0) {
-                // an parw exit
-                current_step = timestamp2;
-                // termatizw ola ta paidia
-                for (int i = 0; i < shm_ptr->child_count; i++) {
-                    if (shm_ptr->child_pids[i] != 0) {
-                        send_message_to_child(i, NULL, 1, current_step);
-                        waitpid(shm_ptr->child_pids[i], NULL, 0);
-                        shm_ptr->child_pids[i] = 0;
-                    }
-                }
-                running = 0;
+                parse_terminate(cmd.child_index, current_step, OP_TERMINATE); // terminate chilld
+            } else if (cmd.opcode == CMD_KILL) {
+                parse_terminate(cmd.child_index, current_step, OP_KILL);
+            } else if (cmd.opcode == CMD_PAUSE) {
+                parse_control(cmd.child_index, OP_PAUSE, 0);
+            } else if (cmd.opcode == CMD_RESUME) {
+                parse_control(cmd.child_index, OP_RESUME, 0);
+            } else if (cmd.opcode == CMD_CREDITS && cmd.arg > 0) {
+                parse_control(cmd.child_index, OP_CREDITS, cmd.arg);
             }
         }
 
-        // an trexei akoma kai yparxoun energa paidia, stile mia grmmh me ena mhnyma se ena tuxaio paidi 
-        if (running) {
-            int active_indices[MAX_CHILDREN];
-            int active_count = 0;
-            for (int i = 0; i < shm_ptr->child_count; i++) {
-                if (shm_ptr->child_pids[i] != 0) //an einai energo
-                    active_indices[active_count++] = i;
-            }
-
-            if (active_count > 0) {
-                // dialekse ena tuxaio energo paidi
-                int target_child = active_indices[rand() % active_count];
-
-                char message_buffer[MESSAGE_SIZE];
-                if (fgets(message_buffer, sizeof(message_buffer), message_file) == NULL) {
-                    rewind(message_file); // If we reach EOF, rewind the file
-                    fgets(message_buffer, sizeof(message_buffer), message_file); // diavase thn prwth grammh
-                }
-
-                size_t len = strlen(message_buffer);
-                if (len > 0 && message_buffer[len-1] == '\n') {
-                    message_buffer[len-1] = '\0'; // an petuxw newline , thn afairw
-                }
-
-                send_message_to_child(target_child, message_buffer, 0, 0); // kanoniko minhma
-            }
+        // an trexei akoma kai yparxoun energa paidia (ektos PAUSE), stile mia grmmh me ena mhnyma se ena paidi
+        if (running && active.count > paused.count) {
+            size_t offset, length;
+            next_corpus_chunk(&offset, &length);
+            // dialekse paidi me thn politikh tou -r, to active_list einai panta enhmero
+            Op op = { .type = OP_SEND, .child_index = pick_target(offset, length),
+                      .offset = offset, .length = length };
+            submit(&op);
         }
     }
 
-    fclose(command_file);  // kleinw to command file
-    fclose(message_file);  // kleinw to message file
+    stop_dispatchers(); // an to arxeio teleiwse xwris EXIT
+    if (thread_workers && active.count > 0) {
+        shutdown_all(current_step); // ta threads den mporoun na zhsoun meta to munmap
+    }
+    release_pool();  // oi workers tou pool pou den xreiasthkan
+    if (timing) {
+        print_stats(K, now_ns() - start_ns);
+    }
+    if (trace_path) {
+        write_trace(trace_path);
+    }
+    if (top_words > 0) {
+        if (!running || thread_workers) {
+            print_words(K);
+        } else {
+            fprintf(stderr, "No EXIT in the command file, the children are still counting words\n");
+        }
+    }
+    if (replay_scale > 0) {
+        unsigned long value[3];
+        percentiles(lag_buckets, lag_count, value);
+        for (int p = 0; p < 3; p++) {
+            if (value[p] > lag_max) value[p] = lag_max; // to bucket exei megalytero orio apo to max
+        }
+        printf("REPLAY commands=%lu p50_lag_ns=%lu p99_lag_ns=%lu p999_lag_ns=%lu max_lag_ns=%lu\n",
+               lag_count, value[0], value[1], value[2], lag_max);
+    }
+    cmd_close(&commands);  // kleinw to command file
+    munmap((void *)corpus, corpus_size);  // kleinw to corpus
 
-    munmap(shm_ptr, sizeof(SharedMemory)); // cleanup
-    sem_close(sem_parent);
-    sem_unlink(SEM_PARENT);
-    shm_unlink(SHM_NAME);  // afairw to shared memory object
+    munmap(shm_ptr, shm_size); // cleanup
+    shm_remove();  // afairw to shared memory object
     for (int i = 0; i < K; i++) {
         if (child_sems[i]) {
             char sem_child_name[64];
@@ -257,6 +1424,28 @@ int main(int argc, char *argv[]) {
             sem_unlink(sem_child_name);
         }
     }
+    free(child_sems);
+    set_free(&active);
+    set_free(&paused);
+    for (int t = 0; t < dispatcher_count; t++) {
+        Dispatcher *d = &dispatchers[t];
+        set_free(&d->owned);
+        set_free(&d->backlogged);
+        set_free(&d->draining);
+        set_free(&d->polled);
+        close(d->epfd);
+        close(d->timerfd);
+        close(d->efd);
+    }
+    for (int i = 0; i < K; i++) {
+        if (child_state[i].pidfd != -1) close(child_state[i].pidfd); // paidia pou trexoun akoma xwris EXIT
+        free(child_state[i].backlog);
+    }
+    free(child_state);
+    free(spawn_gen);
+    free(dispatchers);
+    free(worker_threads);
+    free(worker_args);
 
     return 0;
 }
@@ -0,0 +1,164 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "placement.h"
+
+#ifndef SYSFS_CPU
+#define SYSFS_CPU "/sys/devices/system/cpu"
+#endif
+
+typedef struct {
+    int cpu;
+    int node;     // NUMA node
+    int package;  // socket
+    int core;     // core_id mesa sto socket
+    int rank;     // 0 gia to prwto hyperthread tou core, 1 gia to deutero...
+    int slot;     // poses CPU idiou rank exei to node prin apo authn
+} CpuInfo;
+
+static int placement = PLACE_NONE;
+static int restricted = 0;       // 1 an ta paidia prepei na meinoun se child_cpus
+static cpu_set_t child_cpus;     // oi CPU pou epitrepontai sta paidia
+static int *cpu_order = NULL;  // h CPU tou paidiou i einai h cpu_order[i % cpu_order_count]
+static int cpu_order_count = 0;
+
+int parse_cpu_list(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return -1;
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) return -1;
+        }
+        for (long c = first; c <= last; c++) {
+            CPU_SET(c, set);
+        }
+        if (*end == ',') end++;
+        else if (*end != '\0') return -1;
+        p = end;
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+static int read_int(int cpu, const char *file) {
+    char path[256];
+    snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/%s", cpu, file);
+    FILE *f = fopen(path, "r");
+    int value = 0; // xwris to arxeio (px se VM) ola sto idio
+    if (f) {
+        if (fscanf(f, "%d", &value) != 1) value = 0;
+        fclose(f);
+    }
+    return value;
+}
+
+// to cpuN/nodeM link leei se poio NUMA node einai h CPU
+static int read_node(int cpu) {
+    char path[256];
+    snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    int node = 0;
+    if (dir) {
+        struct dirent *e;
+        while ((e = readdir(dir)) != NULL) {
+            if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+                node = atoi(e->d_name + 4);
+                break;
+            }
+        }
+        closedir(dir);
+    }
+    return node;
+}
+
+// pack: node, meta rank (physical cores prin ta hyperthreads), meta socket/core
+static int cmp_pack(const void *a, const void *b) {
+    const CpuInfo *x = a, *y = b;
+    if (x->node != y->node) return x->node - y->node;
+    if (x->rank != y->rank) return x->rank - y->rank;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+// spread: round robin sta nodes, prwta ena thread apo kathe core
+static int cmp_spread(const void *a, const void *b) {
+    const CpuInfo *x = a, *y = b;
+    if (x->rank != y->rank) return x->rank - y->rank;
+    if (x->slot != y->slot) return x->slot - y->slot;
+    return x->node - y->node;
+}
+
+void placement_init(int policy, const cpu_set_t *parent_cpus) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        perror("sched_getaffinity failed");
+        return;
+    }
+    if (parent_cpus) {
+        // ta paidia den mpainoun stis CPU tou parent, ektos an den menei kamia allh
+        cpu_set_t rest;
+        CPU_XOR(&rest, &allowed, parent_cpus);
+        CPU_AND(&rest, &rest, &allowed);
+        if (CPU_COUNT(&rest) > 0) allowed = rest;
+        child_cpus = allowed;
+        restricted = 1; // alliws tha klhronomousan th mask tou pinned thread pou ta kanei spawn
+    }
+    placement = policy;
+    if (policy == PLACE_NONE) return;
+
+    int n = CPU_COUNT(&allowed);
+    CpuInfo *info = calloc(n, sizeof(CpuInfo));
+    cpu_order = malloc(n * sizeof(int));
+    if (!info || !cpu_order) {
+        perror("malloc failed in placement");
+        exit(1);
+    }
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < n; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        CpuInfo *c = &info[count++];
+        c->cpu = cpu;
+        c->node = read_node(cpu);
+        c->package = read_int(cpu, "physical_package_id");
+        c->core = read_int(cpu, "core_id");
+        for (int i = 0; i < count - 1; i++) { // ta hyperthreads tou idiou core exoun idio package/core
+            if (info[i].package == c->package && info[i].core == c->core) c->rank++;
+        }
+    }
+    qsort(info, count, sizeof(CpuInfo), cmp_pack);
+    for (int i = 0; i < count; i++) { // h thesh ths CPU mesa sto node ths, gia to spread
+        if (i > 0 && info[i - 1].node == info[i].node && info[i - 1].rank == info[i].rank) {
+            info[i].slot = info[i - 1].slot + 1;
+        }
+    }
+    if (policy == PLACE_SPREAD) {
+        qsort(info, count, sizeof(CpuInfo), cmp_spread);
+    }
+    for (int i = 0; i < count; i++) {
+        cpu_order[i] = info[i].cpu;
+    }
+    cpu_order_count = count;
+    free(info);
+}
+
+int placement_set(int child_index, cpu_set_t *set) {
+    if (placement != PLACE_NONE && cpu_order_count > 0) {
+        CPU_ZERO(set);
+        CPU_SET(cpu_order[child_index % cpu_order_count], set);
+        return 1;
+    }
+    if (restricted) {
+        *set = child_cpus;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <sched.h>  // cpu_set_t, oi .c pou to kanoun include orizoun _GNU_SOURCE
+
+// pou mpainei kathe paidi (parent -a)
+#define PLACE_NONE   0   // o scheduler apofasizei
+#define PLACE_SPREAD 1   // diadoxika paidia se diaforetika NUMA nodes kai physical cores
+#define PLACE_PACK   2   // gemizw ena node (prwta ta physical cores) prin paw sto epomeno
+
+// "0-3,8" -> set, epistrefei -1 an to string den einai swsto
+int parse_cpu_list(const char *list, cpu_set_t *set);
+
+// diavazei thn topologia apo to sysfs kai ftiaxnei th seira twn CPU gia ta paidia,
+// xwris tis CPU tou parent an menoun kai alles. Kaleitai prin pinned o parent
+void placement_init(int policy, const cpu_set_t *parent_cpus);
+
+// oi CPU tou paidiou: mia me -a, alliws oses den krataei o parent (-c).
+// Epistrefei 0 an to paidi trexei opou thelei o scheduler
+int placement_set(int child_index, cpu_set_t *set);
+
+#endif
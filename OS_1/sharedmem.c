@@ -5,65 +5,151 @@
 #include <fcntl.h>      
 #include <sys/mman.h>   
 #include <sys/stat.h>  
-#include <semaphore.h>  
+#include <sys/vfs.h>
+#include <linux/magic.h>
 
-#define SHM_NAME "/shared_memory" 
-#define SEM_PARENT "/sem_parent"   
-#define MAX_CHILDREN 100          
-#define MESSAGE_SIZE 256        
+#include "sharedmem.h"
 
-typedef struct {
-    char message[MESSAGE_SIZE];// buffer
-    int child_pids[MAX_CHILDREN];  // pinakas me child PIDs
-    int child_count;  // counter gia to posa paidia exw ftiaksei
-    int child_start_steps[MAX_CHILDREN]; // start time step
-} SharedMemory;
 
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-H] [-P] [-E trace_events] [-W word_slots] [max_children]\n", prog);
+    exit(1);
+}
 
-int main() {
-    // unlink apo prohgoumenh ektelesh
-    shm_unlink(SHM_NAME);     
-    sem_unlink(SEM_PARENT);   
+// -H: to segment sto hugetlbfs, to megethos strogyleuetai se huge selides
+static SharedMemory *map_huge(size_t *shm_size) {
+    struct statfs fs;
+    if (statfs(SHM_HUGE_DIR, &fs) == -1 || fs.f_type != HUGETLBFS_MAGIC) {
+        fprintf(stderr, "%s is not a hugetlbfs mount\n", SHM_HUGE_DIR);
+        return NULL;
+    }
+    size_t huge = fs.f_bsize; // to f_bsize tou hugetlbfs einai to megethos ths huge selidas
+    size_t rounded = (*shm_size + huge - 1) / huge * huge;
+    int fd = open(SHM_HUGE_PATH, O_CREAT | O_RDWR, 0666);
+    if (fd == -1) {
+        perror("open " SHM_HUGE_PATH " failed");
+        return NULL;
+    }
+    SharedMemory *shm_ptr = MAP_FAILED;
+    if (ftruncate(fd, rounded) == -1) {
+        perror("ftruncate on hugetlbfs failed");
+    } else {
+        // oi huge selides kratiountai edw, apotygxanei an den ftanoun oi eleutheres
+        shm_ptr = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (shm_ptr == MAP_FAILED) perror("mmap on hugetlbfs failed");
+    }
+    close(fd);
+    if (shm_ptr == MAP_FAILED) {
+        unlink(SHM_HUGE_PATH);
+        return NULL;
+    }
+    *shm_size = rounded;
+    return shm_ptr;
+}
 
-    // read write permissions shared mem
-    int shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666); 
-    if (shm_fd == -1) {       
-        perror("shm_open failed");
-        exit(1);
+int main(int argc, char *argv[]) {
+    int huge = 0;  // -H: huge pages
+    int backing = 0;
+    unsigned trace_slots = 0; // -E: events ana trace ring, gia to parent -X
+    unsigned word_slots = 0;  // -W: slots ana pinaka leksewn, gia to parent -A
+    int opt;
+    while ((opt = getopt(argc, argv, "HPE:W:")) != -1) {
+        switch (opt) {
+        case 'H':
+            huge = 1;
+            break;
+        case 'P':
+            backing |= SHM_PREFAULT;
+            break;
+        case 'E':
+            trace_slots = strtoul(optarg, NULL, 10);
+            if (trace_slots == 0 || (trace_slots & (trace_slots - 1)) != 0) {
+                fprintf(stderr, "trace_events must be a power of 2\n");
+                exit(1);
+            }
+            break;
+        case 'W':
+            word_slots = strtoul(optarg, NULL, 10);
+            if (word_slots == 0 || (word_slots & (word_slots - 1)) != 0) {
+                fprintf(stderr, "word_slots must be a power of 2\n");
+                exit(1);
+            }
+            break;
+        default:
+            usage(argv[0]);
+        }
     }
+    // posa paidia xwraei to segment, to K tou parent den mporei na einai megalytero
+    int max_children = DEFAULT_MAX_CHILDREN;
+    if (optind < argc) {
+        max_children = atoi(argv[optind]);
+        if (max_children <= 0) {
+            usage(argv[0]);
+        }
+    }
+    size_t shm_size = shm_size_for(max_children, trace_slots, word_slots);
+
+    // unlink apo prohgoumenh ektelesh
+    shm_remove();
 
-    //sharedmemobejct=sharedmem
-    if (ftruncate(shm_fd, sizeof(SharedMemory)) == -1) {
-        perror("ftruncate failed");
-        exit(1);
+    SharedMemory *shm_ptr = NULL;
+    if (huge) {
+        shm_ptr = map_huge(&shm_size);
+        if (shm_ptr) {
+            backing |= SHM_HUGETLB;
+        } else {
+            // xwris hugetlbfs dokimazw transparent huge pages sto /dev/shm
+            fprintf(stderr, "Falling back to /dev/shm with transparent huge pages\n");
+            backing |= SHM_THP;
+        }
     }
+    if (!shm_ptr) {
+        // read write permissions shared mem
+        int shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+        if (shm_fd == -1) {
+            perror("shm_open failed");
+            exit(1);
+        }
 
-    // map thn shared memory sto process
-    SharedMemory *shm_ptr = mmap(NULL, sizeof(SharedMemory), PROT_READ | PROT_WRITE,
-                                 MAP_SHARED, shm_fd, 0);
-    if (shm_ptr == MAP_FAILED) {  
-        perror("mmap failed");
-        exit(1);
+        //sharedmemobejct=sharedmem
+        if (ftruncate(shm_fd, shm_size) == -1) {
+            perror("ftruncate failed");
+            exit(1);
+        }
+
+        // map thn shared memory sto process
+        shm_ptr = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+        if (shm_ptr == MAP_FAILED) {
+            perror("mmap failed");
+            exit(1);
+        }
+        close(shm_fd);
+    }
+    if (backing & SHM_THP) {
+        madvise(shm_ptr, shm_size, MADV_HUGEPAGE); // prin to memset, gia na desmeutoun huge selides
     }
 
     // init to shared mem me 0
-    memset(shm_ptr, 0, sizeof(SharedMemory));
+    memset(shm_ptr, 0, shm_size);
+    shm_ptr->magic = SHM_MAGIC;
+    shm_ptr->version = SHM_LAYOUT_VERSION;
+    shm_ptr->size = shm_size;
+    shm_ptr->max_children = max_children;
+    shm_ptr->backing = backing;  // to diavazei kathe diergasia sto shm_attach
     shm_ptr->child_count = 0;    //  den exoume paidia akoma
+    shm_ptr->trace_slots = trace_slots;
+    shm_ptr->word_slots = word_slots;
+    shm_ptr->dispatchers = 1;    //  to allazei o parent me -j
 
-    //  semaphore gia ton parent me timh 1
-    sem_t *sem_parent = sem_open(SEM_PARENT, O_CREAT | O_EXCL, 0666, 1);
-    if (sem_parent == SEM_FAILED) {             
-        perror("sem_open (parent) failed");
-        exit(1);
-    }
+    // o parent ftiaxnei ta eventfd twn dispatchers tou, ta paidia ta klhronomoun
 
     // debug
-    printf("Semaphore /sem_parent created successfully.\n");
-    printf("Shared memory created at: %p\n", (void *)shm_ptr);
-    printf("Shared memory and semaphores successfully initialized.\n");
+    printf("Shared memory created at: %p (%zu bytes, %d children, %s%s)\n", (void *)shm_ptr, shm_size, max_children,
+           (backing & SHM_HUGETLB) ? "hugetlbfs" : (backing & SHM_THP) ? "/dev/shm + THP" : "/dev/shm",
+           (backing & SHM_PREFAULT) ? ", prefaulted" : "");
+    printf("Shared memory successfully initialized.\n");
  //cleanum
-    munmap(shm_ptr, sizeof(SharedMemory));
-    sem_close(sem_parent);
+    munmap(shm_ptr, shm_size);
 
     return 0; 
 }
@@ -0,0 +1,418 @@
+#ifndef SHAREDMEM_H
+#define SHAREDMEM_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/futex.h>
+
+#define SHM_NAME "/shared_memory"
+#define DEFAULT_MAX_CHILDREN 100   // an to sharedmem treksei xwris orisma
+
+// to layout tou segment, oi treis diergasies prepei na symfwnoun se auta
+#define SHM_MAGIC 0x4f53314dU      // "OS1M"
+#define SHM_LAYOUT_VERSION 14      // auksanetai se kathe allagh tou SharedMemory/ChildControl
+#define CORPUS_FILE "mobydick.txt"
+
+// sharedmem -H: to segment ginetai arxeio sto hugetlbfs anti gia /dev/shm
+#ifndef SHM_HUGE_DIR
+#define SHM_HUGE_DIR "/dev/hugepages"
+#endif
+#define SHM_HUGE_PATH SHM_HUGE_DIR "/os1_shared_memory"
+
+// pws einai sthmeno to segment (SharedMemory.backing)
+#define SHM_HUGETLB  1   // hugetlbfs (sharedmem -H)
+#define SHM_THP      2   // /dev/shm me MADV_HUGEPAGE, an to -H den vrhke huge pages
+#define SHM_PREFAULT 4   // kathe diergasia kanei prefault olo to mapping sto attach (sharedmem -P)
+
+// entoles tou control lane, to paidi ta koitaei prin thn oura twn mhnymatwn
+#define CTRL_DRAIN     0   // T: teleiwnei osa exei sthn oura kai termatizei sto step arg
+#define CTRL_KILL      1   // KILL: termatizei amesws sto step arg, ta mhnymata ths ouras petiountai
+#define CTRL_PAUSE     2   // stamataei na pairnei mhnymata mexri to CTRL_RESUME
+#define CTRL_RESUME    3
+#define CTRL_CREDITS   4   // reconfigure: nea credits = arg (parent CREDITS)
+
+#define CTRL_SLOTS 8       // dunamh tou 2, olo to lane se ena cache line
+
+// tropos ksypnhmatos metaksu parent kai paidiwn
+#define TRANSPORT_SEM   0   // named POSIX semaphores (/sem_child_%d)
+#define TRANSPORT_FUTEX 1   // futex words mesa sto SharedMemory
+
+#define CACHE_LINE 64        // ta blocks pou grafoun diaforetikes diergasies den moirazontai grammh
+#define MAX_DISPATCHERS 64   // max dispatcher threads tou parent (-j)
+
+// katastaseis enos worker tou pool
+#define POOL_EMPTY    0   // kanenas worker se auto to slot
+#define POOL_PARKED   1   // o worker perimenei anathesh
+#define POOL_ASSIGNED 2   // o parent tou edwse child_index, ksekinaei san kanoniko paidi
+#define POOL_EXIT     3   // den xreiasthke, kanei exit
+
+// histogramma latency: log-linear buckets, LAT_SUB ypo-buckets gia kathe dunamh tou 2
+#define LAT_SUB_BITS 4
+#define LAT_SUB (1 << LAT_SUB_BITS)
+#define LAT_GROUPS 38                       // ews ~2^41 ns, ta megalytera mpainoun sto teleutaio
+#define LAT_BUCKETS (LAT_GROUPS * LAT_SUB)
+
+// events tou trace (parent -X), me th seira pou pernaei ena mhnyma
+#define TRACE_SPAWN     0   // dispatcher: to paidi ksekinhse, arg = pid
+#define TRACE_ENQUEUE   1   // dispatcher: mhnyma sthn oura, arg = thesh sthn oura
+#define TRACE_WAKE      2   // dispatcher: syscall gia na ksypnhsei to paidi
+#define TRACE_WAKEUP    3   // paidi: ksypnhse apo futex/semaphore
+#define TRACE_DEQUEUE   4   // paidi: phre ta mhnymata ws to arg (apokleistika)
+#define TRACE_ACK       5   // paidi: ACK gia ola ws to arg (apokleistika)
+#define TRACE_CONTROL   6   // dispatcher: entolh sto control lane, arg = CTRL_*
+#define TRACE_EXIT      7   // dispatcher: reaping, arg = 1 an to paidi pethane xwris TERMINATE
+#define TRACE_TYPES     8
+
+#ifndef RING_SLOTS
+#define RING_SLOTS 16   // posa mhnymata xwraei h oura kathe paidiou (dunamh tou 2)
+#endif
+
+// to slot krataei mono descriptor, ta bytes ta diavazei to paidi apeutheias apo to corpus.
+// H oura exei mono grammes, oi entoles pane sto control lane
+typedef struct {
+    size_t offset;     // pou ksekinaei to mhnyma mesa sto corpus
+    size_t length;     // mia h perissoteres grammes (parent -l), xwris to teleutaio '\n'
+    unsigned long enqueue_ns; // pote to evale o parent sthn oura (mono me -s)
+} RingSlot;
+
+// mia entolh tou control lane
+typedef struct {
+    int op;            // CTRL_*
+    int arg;           // step gia DRAIN/KILL, credits gia CREDITS
+} CtrlSlot;
+
+// oura SPSC: o parent grafei mono to head, to paidi grafei mono to tail.
+// Ta pedia tou parent kai tou paidiou einai se xwrista cache lines, etsi kathe zeugari
+// parent/paidi xtupaei mono tis dikes tou grammes kai oxi tou geitona.
+// To control lane (ctrl_head/ctrl_tail) einai mia deuterh, mikrh SPSC oura me ton idio kanona.
+typedef struct {
+    // producer line, ta grafei mono o parent
+    _Alignas(CACHE_LINE) atomic_uint head;   // epomeno slot pou tha grapsei o parent
+    atomic_uint doorbell;          // futex word tou paidiou, to auksanei o parent gia na to ksypnhsei
+    unsigned sent;                 // kanonika mhnymata pou tou steilame
+    unsigned acked_seen;           // to teleutaio acked pou exei metrhsei o parent sto inflight
+    unsigned credits;              // posa mhnymata mporei na exei o parent se ptisi sto paidi (parent -C)
+    atomic_uint ctrl_head;         // epomenh entolh pou tha grapsei o parent
+    // consumer line, ta grafei mono to paidi
+    _Alignas(CACHE_LINE) atomic_uint tail;   // epomeno slot pou tha diavasei to paidi
+    atomic_uint acked;             // cumulative ACK: posa mhnymata exei teleiwsei to paidi, epistrefei ta credits
+    atomic_int child_sleeping;     // 1 otan to paidi koimatai sto doorbell
+    atomic_uint ctrl_tail;         // epomenh entolh pou tha diavasei to paidi
+    _Alignas(CACHE_LINE) CtrlSlot ctrl[CTRL_SLOTS];
+    _Alignas(CACHE_LINE) RingSlot slots[RING_SLOTS];
+} ChildQueue;
+
+// ola osa afora ena paidi, ena block ana index, panta polaplasio tou CACHE_LINE
+typedef struct {
+    ChildQueue queue;    // h oura tou paidiou
+    _Alignas(CACHE_LINE) int pid;  // PID tou paidiou, 0 an den trexei (ta grafei o parent sto spawn)
+    int start_step;      // start time step
+    // live telemetry, ta grafei mono to paidi meta apo kathe batch kai ta diavazei to shmstat.
+    // Athroizoun gia ola ta paidia pou pernane apo to idio index
+    _Alignas(CACHE_LINE) atomic_ulong messages;  // kanonika mhnymata
+    atomic_ulong bytes;                          // bytes keimenou
+    atomic_ulong busy_ns;                        // xronos epeksergasias apo to ksypnhma ws to ACK (mono me -s)
+    atomic_ulong wakeups;                        // poses fores koimhthke kai ksypnhse
+    unsigned latency[LAT_BUCKETS]; // dispatch-to-ACK latency, to grafei mono to paidi (mono me -s)
+} ChildControl;
+_Static_assert(sizeof(ChildControl) % CACHE_LINE == 0, "ChildControl must fill whole cache lines");
+
+// ena event tou trace, to grafei mono h diergasia h to thread pou exei to ring
+typedef struct {
+    uint64_t ns;         // CLOCK_MONOTONIC
+    uint64_t arg;        // analoga me to type
+    int32_t child;       // index tou paidiou
+    uint16_t type;       // TRACE_*
+    int16_t source;      // dispatcher id, -1 an to egrapse to paidi
+} TraceEvent;
+
+// flight recorder: krataei ta teleutaia trace_slots events, ta palia ta pianoun ta nea
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_ulong head;  // posa events exoun graftei synolika
+    TraceEvent events[];                    // trace_slots events
+} TraceRing;
+
+// to arxeio tou parent -X: header kai meta ola ta events pou kratithikan
+#define TRACE_MAGIC "OS1T"
+#define TRACE_VERSION 2
+
+typedef struct {
+    char magic[4];       // TRACE_MAGIC
+    uint32_t version;    // TRACE_VERSION
+    uint64_t count;      // posa TraceEvent akolouthoun
+    uint64_t dropped;    // posa xathikan epeidh to ring gemise
+} TraceHeader;
+
+// parent -A: kathe paidi metraei tis lekseis twn mhnymatwn tou ston diko tou pinaka (sharedmem -W)
+#define WORD_MAX 24        // bytes ana leksh mazi me to '\0', oi megalyteres kovontai
+
+typedef struct {
+    uint32_t hash;         // 0 = adeio slot
+    uint32_t count;
+    char word[WORD_MAX];   // peza
+} WordEntry;
+
+// open addressing me linear probing, ton grafei mono to paidi tou index kai ton diavazei o
+// parent sto EXIT. Athroizei gia ola ta paidia pou pernane apo to idio index, opws to telemetry
+typedef struct {
+    _Alignas(CACHE_LINE) unsigned long words;  // oles oi lekseis pou metrhthhkan
+    unsigned long dropped;         // lekseis pou den xwresan, o pinakas eixe gemisei
+    unsigned used;                 // gemata slots
+    unsigned long chars[256];      // syxnothta kathe byte
+    WordEntry entries[];           // word_slots
+} WordTable;
+
+// ena slot gia kathe prespawned worker, se diko tou cache line
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint state;   // futex word, POOL_*
+    int pid;             // PID tou worker
+    int child_index;     // se poio paidi antistoixei otan ginei POOL_ASSIGNED
+} PoolSlot;
+
+// pou koimatai enas dispatcher tou parent, ena gia kathe shard se diko tou cache line
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_int waiting;   // 1 otan o dispatcher koimatai sto epoll
+    int efd;              // eventfd tou dispatcher, ta paidia to klhronomoun me to idio noumero
+} ParentWake;
+
+// header, meta ena ChildControl gia kathe paidi, meta max_children PoolSlot,
+// (me sharedmem -E) ta trace rings kai (me sharedmem -W) ena WordTable gia kathe paidi,
+// to megethos to apofasizei to sharedmem
+typedef struct {
+    unsigned magic;                      // SHM_MAGIC
+    unsigned version;                    // SHM_LAYOUT_VERSION
+    size_t size;                         // synoliko megethos tou segment se bytes
+    int max_children;                    // posa ChildControl xwrane
+    int backing;                         // SHM_HUGETLB | SHM_THP | SHM_PREFAULT
+    int child_count;  // counter gia to posa paidia exw ftiaksei
+    unsigned trace_slots;                // events ana trace ring (sharedmem -E), 0 = xwris trace
+    int tracing;                         // 1 an grafoume trace (parent -X)
+    unsigned word_slots;                 // slots ana WordTable (sharedmem -W), 0 = xwris pinakes
+    int analytics;                       // 1 an ta paidia metrane lekseis (parent -A)
+    int dispatchers;                     // posa shards exei o parent, to paidi i anhkei sto i % dispatchers
+    ParentWake parent_wake[MAX_DISPATCHERS]; // ena gia kathe dispatcher
+    int transport;                       // TRANSPORT_SEM h TRANSPORT_FUTEX, to dialegei o parent
+    int timing;                          // 1 an metrame latency (parent -s)
+    int batch;                           // 1 an ta paidia adeiazoun olh thn oura se kathe ksypnhma (parent -b)
+    char corpus_path[PATH_MAX];          // apolyto path tou corpus, to kanoun map ola ta paidia
+    _Alignas(CACHE_LINE) atomic_int shutdown;  // broadcast EXIT: ola ta paidia termatizoun molis adeiasei h oura tous
+    int shutdown_step;                   // to step tou EXIT, grafetai prin to shutdown
+    ChildControl children[];             // max_children blocks
+} SharedMemory;
+
+// ena ring gia kathe paidi kai meta ena gia kathe dispatcher, ola me to idio megethos
+static inline size_t trace_ring_size(unsigned trace_slots) {
+    size_t size = sizeof(TraceRing) + (size_t)trace_slots * sizeof(TraceEvent);
+    return (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+static inline size_t word_table_size(unsigned word_slots) {
+    size_t size = sizeof(WordTable) + (size_t)word_slots * sizeof(WordEntry);
+    return (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+static inline size_t shm_size_for(int max_children, unsigned trace_slots, unsigned word_slots) {
+    size_t size = sizeof(SharedMemory) + (size_t)max_children * (sizeof(ChildControl) + sizeof(PoolSlot));
+    if (trace_slots > 0) {
+        size = (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        size += (size_t)(max_children + MAX_DISPATCHERS) * trace_ring_size(trace_slots);
+    }
+    if (word_slots > 0) {
+        size = (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        size += (size_t)max_children * word_table_size(word_slots);
+    }
+    return size;
+}
+
+// ta PoolSlot ksekinane amesws meta ton pinaka twn paidiwn
+static inline PoolSlot *shm_pool(SharedMemory *shm) {
+    return (PoolSlot *)&shm->children[shm->max_children];
+}
+
+// ta trace rings meta ta PoolSlot: 0..max_children-1 ta paidia, meta oi dispatchers
+static inline TraceRing *shm_trace_ring(SharedMemory *shm, int ring) {
+    size_t start = (size_t)((char *)&shm_pool(shm)[shm->max_children] - (char *)shm);
+    start = (start + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    return (TraceRing *)((char *)shm + start + (size_t)ring * trace_ring_size(shm->trace_slots));
+}
+
+// oi WordTable meta ta trace rings (h meta ta PoolSlot xwris -E), ena gia kathe paidi
+static inline WordTable *shm_word_table(SharedMemory *shm, int child_index) {
+    size_t start = shm_size_for(shm->max_children, shm->trace_slots, 0);
+    start = (start + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    return (WordTable *)((char *)shm + start + (size_t)child_index * word_table_size(shm->word_slots));
+}
+
+// posa mhnymata perimenoun sthn oura
+static inline unsigned queue_depth(ChildQueue *q) {
+    return atomic_load(&q->head) - atomic_load(&q->tail);
+}
+
+// posa mhnymata exei steilei o parent sto paidi kai den exoun ginei akoma ACK (gia to routing)
+static inline unsigned child_load(ChildControl *child) {
+    return atomic_load(&child->queue.head) - atomic_load(&child->queue.acked);
+}
+
+static inline RingSlot *queue_slot(ChildQueue *q, unsigned pos) {
+    return &q->slots[pos & (RING_SLOTS - 1)];
+}
+
+static inline unsigned long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+// se poio bucket tou histogrammatos paei mia latency
+static inline int lat_bucket(unsigned long ns) {
+    if (ns < LAT_SUB) return ns;
+    int msb = 63 - __builtin_clzl(ns);
+    int group = msb - LAT_SUB_BITS + 1;
+    if (group >= LAT_GROUPS) return LAT_BUCKETS - 1;
+    return group * LAT_SUB + ((ns >> (msb - LAT_SUB_BITS)) & (LAT_SUB - 1));
+}
+
+// h megalyterh timh pou xwraei sto bucket
+static inline unsigned long lat_bucket_max(int bucket) {
+    int group = bucket / LAT_SUB, sub = bucket % LAT_SUB;
+    if (group == 0) return sub;
+    int shift = group - 1;
+    return ((unsigned long)(LAT_SUB + sub + 1) << shift) - 1;
+}
+
+// grafei ena event sto ring, tipota an den trexei trace
+static inline void trace_event(SharedMemory *shm, int ring, int type, int child, uint64_t arg) {
+    if (!shm->tracing) return;
+    TraceRing *r = shm_trace_ring(shm, ring);
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    TraceEvent *e = &r->events[head & (shm->trace_slots - 1)];
+    e->ns = now_ns();
+    e->arg = arg;
+    e->child = child;
+    e->type = type;
+    e->source = ring < shm->max_children ? -1 : ring - shm->max_children;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release); // to diavazei o parent sto telos
+}
+
+// grafw se kathe selida tou mapping, wste na mhn yparxei first-touch fault sto hot path
+static inline void shm_prefault(void *addr, size_t size) {
+    if (madvise(addr, size, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+    long page = sysconf(_SC_PAGESIZE); // palios kernel, to kanw me to xeri
+    for (size_t off = 0; off < size; off += page) {
+        __atomic_fetch_add((char *)addr + off, 0, __ATOMIC_RELAXED); // write fault xwris na allaksei tipota
+    }
+}
+
+// oti zhthse to sharedmem gia to segment, to kanei kathe diergasia sto diko ths mapping
+static inline void shm_prepare(void *addr, size_t size, int backing) {
+    if (backing & SHM_THP) {
+        madvise(addr, size, MADV_HUGEPAGE); // an to kernel den to dexetai, menoume se 4K selides
+    }
+    if (backing & SHM_PREFAULT) {
+        shm_prefault(addr, size);
+    }
+}
+
+static inline void shm_remove(void) {
+    shm_unlink(SHM_NAME);
+    unlink(SHM_HUGE_PATH); // an to eftiakse to sharedmem -H
+}
+
+// anoigw to segment pou eftiakse to sharedmem kai elegxw oti symfwnoume sto layout
+// prot: PROT_READ | PROT_WRITE gia parent/paidia, PROT_READ gia to shmstat
+static inline SharedMemory *shm_attach(const char *who, size_t *size, int prot) {
+    int flags = (prot & PROT_WRITE) ? O_RDWR : O_RDONLY;
+    int shm_fd = open(SHM_HUGE_PATH, flags); // prwta to hugetlbfs, meta to /dev/shm
+    if (shm_fd == -1) {
+        shm_fd = shm_open(SHM_NAME, flags, 0666);
+    }
+    if (shm_fd == -1) {
+        fprintf(stderr, "shm_open failed in %s: %s\n", who, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(shm_fd, &st) == -1 || (size_t)st.st_size < sizeof(SharedMemory)) {
+        fprintf(stderr, "Shared memory too small in %s, run ./sharedmem first\n", who);
+        close(shm_fd);
+        return NULL;
+    }
+    SharedMemory *shm = mmap(NULL, st.st_size, prot, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "mmap failed in %s: %s\n", who, strerror(errno));
+        return NULL;
+    }
+    if (shm->magic != SHM_MAGIC || shm->version != SHM_LAYOUT_VERSION || shm->size != (size_t)st.st_size) {
+        fprintf(stderr, "Shared memory layout mismatch in %s (version %u, expected %u)\n",
+                who, shm->version, SHM_LAYOUT_VERSION);
+        munmap(shm, st.st_size);
+        return NULL;
+    }
+    if (prot & PROT_WRITE) {
+        shm_prepare(shm, st.st_size, shm->backing); // to prefault grafei, oxi se read-only mapping
+    }
+    *size = st.st_size;
+    return shm;
+}
+
+// map tou corpus read-only, oi selides moirazontai apo to page cache se oles tis diergasies
+static inline const char *map_corpus(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("open corpus failed");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "Corpus %s is empty or unreadable\n", path);
+        close(fd);
+        return NULL;
+    }
+    const char *corpus = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // to mapping menei kai meta to close
+    if (corpus == MAP_FAILED) {
+        perror("mmap corpus failed");
+        return NULL;
+    }
+    *size = st.st_size;
+    return corpus;
+}
+
+static inline long futex_wait(atomic_uint *word, unsigned expected) {
+    // koimatai mono an to word exei akoma thn timh expected (to elegxei o kernel)
+    return syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+static inline long futex_wake(atomic_uint *word, int count) {
+    return syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// me futex h batch ksypname to paidi mono an koimatai, alliws ena sem_post gia kathe mhnyma
+static inline int doorbell_mode(SharedMemory *shm) {
+    return shm->transport == TRANSPORT_FUTEX || shm->batch;
+}
+
+// ksypnaw ton dispatcher tou paidiou mono an koimatai (waiting), alliws kanena syscall.
+// To cache line to moirazontai ola ta paidia tou shard: prwta load, to exchange mono an koimatai
+static inline void notify_parent(SharedMemory *shm, int child_index) {
+    ParentWake *pw = &shm->parent_wake[child_index % shm->dispatchers];
+    if (!atomic_load(&pw->waiting) || !atomic_exchange(&pw->waiting, 0)) return;
+    eventfd_write(pw->efd, 1); // to epoll tou dispatcher vlepei to eventfd readable
+}
+
+#endif
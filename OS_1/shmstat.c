@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sharedmem.h"
+
+// ena snapshot twn counters enos paidiou
+typedef struct {
+    unsigned long messages, bytes, busy_ns, wakeups;
+    unsigned latency[LAT_BUCKETS];
+} ChildSample;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-i interval_ms] [-n count]\n", prog);
+    exit(1);
+}
+
+static void sample(SharedMemory *shm, ChildSample *s) {
+    for (int i = 0; i < shm->max_children; i++) {
+        ChildControl *child = &shm->children[i];
+        s[i].messages = atomic_load_explicit(&child->messages, memory_order_relaxed);
+        s[i].bytes = atomic_load_explicit(&child->bytes, memory_order_relaxed);
+        s[i].busy_ns = atomic_load_explicit(&child->busy_ns, memory_order_relaxed);
+        s[i].wakeups = atomic_load_explicit(&child->wakeups, memory_order_relaxed);
+        memcpy(s[i].latency, child->latency, sizeof(s[i].latency)); // mporei na allazei oso to antigrafw, gia stats ftanei
+    }
+}
+
+// p99 tou diasthmatos apo th diafora twn histogrammatwn, 0 an den eixe mhnymata
+static unsigned long interval_p99(const ChildSample *prev, const ChildSample *cur) {
+    unsigned long total = 0, seen = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        total += cur->latency[b] - prev->latency[b];
+    }
+    for (int b = 0; b < LAT_BUCKETS && total > 0; b++) {
+        seen += cur->latency[b] - prev->latency[b];
+        if (seen >= 0.99 * total) return lat_bucket_max(b);
+    }
+    return 0;
+}
+
+// diavazei to telemetry twn paidiwn read-only kai typwnei rates gia kathe diasthma
+int main(int argc, char *argv[]) {
+    long interval_ms = 1000;
+    long count = -1; // -1 = mexri na svhstei to segment
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval_ms = atol(optarg);
+            if (interval_ms <= 0) usage(argv[0]);
+            break;
+        case 'n':
+            count = atol(optarg);
+            if (count <= 0) usage(argv[0]);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    size_t shm_size;
+    SharedMemory *shm = shm_attach("shmstat", &shm_size, PROT_READ);
+    if (!shm) {
+        exit(1);
+    }
+    // krataw ena fd gia na dw pote to parent kanei unlink to segment sto telos
+    int fd = open(SHM_HUGE_PATH, O_RDONLY);
+    if (fd == -1) {
+        fd = shm_open(SHM_NAME, O_RDONLY, 0);
+    }
+
+    int K = shm->max_children;
+    ChildSample *prev = malloc(K * sizeof(ChildSample));
+    ChildSample *cur = malloc(K * sizeof(ChildSample));
+    if (!prev || !cur) {
+        perror("malloc failed in shmstat");
+        exit(1);
+    }
+    sample(shm, prev);
+    unsigned long prev_ns = now_ns(), start_ns = prev_ns;
+
+    for (long n = 0; count < 0 || n < count; n++) {
+        struct timespec ts = { interval_ms / 1000, (interval_ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+        sample(shm, cur);
+        unsigned long now = now_ns();
+        double secs = (now - prev_ns) / 1e9;
+
+        unsigned long total = 0;
+        int running = 0;
+        for (int i = 0; i < K; i++) {
+            total += cur[i].messages - prev[i].messages;
+            running += shm->children[i].pid != 0;
+        }
+        printf("--- t=%.1fs children=%d msgs/s=%.0f\n", (now - start_ns) / 1e9, running, total / secs);
+        printf("%6s %8s %12s %10s %11s %6s %6s %10s\n", "child", "pid", "msgs/s", "MB/s", "wakeups/s", "busy%", "queue", "p99_ns");
+        for (int i = 0; i < K; i++) {
+            ChildControl *child = &shm->children[i];
+            unsigned long msgs = cur[i].messages - prev[i].messages;
+            if (child->pid == 0 && msgs == 0) continue; // mono osa trexoun h douleuan sto diasthma
+            char name[16], busy[16] = "-", p99[24] = "-";
+            snprintf(name, sizeof(name), "C%d", i + 1);
+            if (shm->timing) { // to busy_ns kai to histogramma grafontai mono me parent -s
+                snprintf(busy, sizeof(busy), "%.1f", (cur[i].busy_ns - prev[i].busy_ns) / (secs * 1e7));
+                snprintf(p99, sizeof(p99), "%lu", interval_p99(&prev[i], &cur[i]));
+            }
+            printf("%6s %8d %12.0f %10.2f %11.0f %6s %6u %10s\n", name, child->pid,
+                   msgs / secs, (cur[i].bytes - prev[i].bytes) / secs / 1e6,
+                   (cur[i].wakeups - prev[i].wakeups) / secs, busy, queue_depth(&child->queue), p99);
+        }
+        fflush(stdout);
+
+        ChildSample *tmp = prev;
+        prev = cur;
+        cur = tmp;
+        prev_ns = now;
+        struct stat st;
+        if (fd != -1 && fstat(fd, &st) == 0 && st.st_nlink == 0) {
+            printf("Shared memory removed, the run is over\n");
+            break;
+        }
+    }
+
+    if (fd != -1) close(fd);
+    free(prev);
+    free(cur);
+    munmap(shm, shm_size);
+    return 0;
+}
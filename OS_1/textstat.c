@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "textstat.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXT_X86 1
+#endif
+
+// 64 bytes -> ena bit gia kathe byte pou anhkei se leksh
+typedef uint64_t (*classify_fn)(const unsigned char *p);
+
+static unsigned char word_byte[256];      // 1 gia A-Z, a-z, 0-9
+static classify_fn classify;
+static const char *kernel_name;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static uint64_t classify_scalar(const unsigned char *p) {
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        mask |= (uint64_t)word_byte[p[i]] << i;
+    }
+    return mask;
+}
+
+#ifdef TEXT_X86
+// oi sygkriseis einai signed: ta bytes >= 0x80 einai arnhtika kai den perasoun pote.
+// To b | 0x20 kanei ta kefalaia mikra xwris na ftiaxnei alla grammata
+__attribute__((target("sse2")))
+static uint64_t classify_sse2(const unsigned char *p) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i before_a = _mm_set1_epi8('a' - 1), after_z = _mm_set1_epi8('z' + 1);
+    const __m128i before_0 = _mm_set1_epi8('0' - 1), after_9 = _mm_set1_epi8('9' + 1);
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i lower = _mm_or_si128(b, case_bit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a), _mm_cmplt_epi8(lower, after_z));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(b, before_0), _mm_cmplt_epi8(b, after_9));
+        mask |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_or_si128(letter, digit)) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t classify_avx2(const unsigned char *p) {
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+    const __m256i before_a = _mm256_set1_epi8('a' - 1), after_z = _mm256_set1_epi8('z' + 1);
+    const __m256i before_0 = _mm256_set1_epi8('0' - 1), after_9 = _mm256_set1_epi8('9' + 1);
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lower = _mm256_or_si256(b, case_bit);
+        __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lower, before_a), _mm256_cmpgt_epi8(after_z, lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(b, before_0), _mm256_cmpgt_epi8(after_9, b));
+        mask |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_or_si256(letter, digit)) << i;
+    }
+    return mask;
+}
+#endif
+
+static void pick_kernel(void) {
+    for (int c = 0; c < 256; c++) {
+        word_byte[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    }
+    classify = classify_scalar;
+    kernel_name = "scalar";
+#ifdef TEXT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classify = classify_avx2;
+        kernel_name = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        classify = classify_sse2;
+        kernel_name = "sse2";
+    }
+#endif
+}
+
+const char *text_init(void) {
+    pthread_once(&kernel_once, pick_kernel); // sto thread mode to kaloun ola ta paidia
+    return kernel_name;
+}
+
+// to kleidi einai h leksh me mikra, symplhrwmenh me mhdenika ws WORD_MAX bytes: h sygkrish
+// ginetai me sygkekrimeno megethos kai to hash me treis pollaplasiasmous anti gia ena ana byte
+static inline uint32_t word_hash(const uint64_t *key) {
+    uint64_t mix = key[0] * 0x9E3779B97F4A7C15ULL ^ key[1] * 0xC2B2AE3D27D4EB4FULL ^ key[2] * 0x165667B19E3779F9ULL;
+    uint32_t h = mix >> 32; // ta panw bits eksartwntai apo ola ta bytes tou kathe kommatiou
+    return h ? h : 1;       // pote 0 giati to 0 shmainei adeio slot
+}
+
+// h thesh apo ta panw bits tou hash, gia opoiodhpote megethos pinaka
+static inline unsigned hash_slot(uint32_t h, unsigned slots) {
+    return (uint32_t)(((uint64_t)h * slots) >> 32);
+}
+
+_Static_assert(WORD_MAX == 3 * sizeof(uint64_t), "word_hash reads the key as three words");
+
+// ta prwta n bytes enos uint64_t (little endian), n apo 0 ws 8
+static inline uint64_t low_bytes(long n) {
+    if (n <= 0) return 0;
+    return n >= 8 ? ~0ULL : (1ULL << (n * 8)) - 1;
+}
+
+// w: h leksh, len bytes. An xwrane WORD_MAX bytes sto readable, to kleidi ftiaxnetai me treis
+// loads kai maskes, alliws byte byte (mono oi teleutaies lekseis tou corpus)
+static void word_add(WordTable *t, unsigned slots, const unsigned char *w, size_t len, size_t readable) {
+    uint64_t key[WORD_MAX / sizeof(uint64_t)] = { 0 };
+    if (len > WORD_MAX - 1) len = WORD_MAX - 1; // menei toulaxiston ena '\0'
+    if (readable >= WORD_MAX) {
+        memcpy(key, w, WORD_MAX);
+        for (int i = 0; i < 3; i++) {
+            uint64_t keep = low_bytes((long)len - i * 8);
+            key[i] = (key[i] | (0x2020202020202020ULL & keep)) & keep; // mono grammata kai pshfia edw, ta pshfia exoun hdh to 0x20
+        }
+    } else {
+        char *k = (char *)key;
+        for (size_t i = 0; i < len; i++) {
+            k[i] = w[i] | 0x20;
+        }
+    }
+    uint32_t h = word_hash(key);
+    t->words++;
+    for (unsigned i = hash_slot(h, slots);; i = (i + 1) & (slots - 1)) {
+        WordEntry *e = &t->entries[i];
+        if (e->hash == h && memcmp(e->word, key, WORD_MAX) == 0) {
+            e->count++;
+            return;
+        }
+        if (e->hash == 0) {
+            if (t->used >= slots / 4 * 3) { // pio gemato kai to probing megalwnei poly
+                t->dropped++;
+                return;
+            }
+            memcpy(e->word, key, WORD_MAX);
+            e->count = 1;
+            e->hash = h;
+            t->used++;
+            return;
+        }
+    }
+}
+
+void text_count(WordTable *t, unsigned slots, const char *text, size_t len, size_t readable) {
+    const unsigned char *p = (const unsigned char *)text;
+    for (size_t i = 0; i < len; i++) {
+        t->chars[p[i]]++;
+    }
+
+    // ana 64 bytes: o classifier dinei th maska kai oi allages ths maskas einai oi arxes kai
+    // ta telh twn leksewn. To carry krataei an to prohgoumeno block teleiwse mesa se leksh
+    unsigned char tail[64];
+    const unsigned char *word = p;
+    uint64_t carry = 0;
+    for (size_t base = 0; base < len; base += 64) {
+        const unsigned char *block = p + base;
+        uint64_t mask;
+        if (readable - base >= 64) {
+            mask = classify(block); // diavazei kai meta to mhnyma, ta bits auta kovontai
+        } else {
+            // sto telos tou corpus se buffer me mhdenika, den diavazw pera apo to mapping
+            memcpy(tail, block, readable - base);
+            memset(tail + (readable - base), 0, 64 - (readable - base));
+            mask = classify(tail);
+        }
+        if (len - base < 64) {
+            mask &= (1ULL << (len - base)) - 1;
+        }
+        uint64_t edges = mask ^ (mask << 1 | carry);
+        carry = mask >> 63;
+        while (edges) {
+            int i = __builtin_ctzll(edges);
+            edges &= edges - 1;
+            if ((mask >> i) & 1) {
+                word = block + i; // arxh lekshs
+            } else {
+                word_add(t, slots, word, block + i - word, readable - (word - p));
+            }
+        }
+    }
+    if (carry) {
+        word_add(t, slots, word, p + len - word, readable - (word - p)); // to mhnyma teleiwnei mesa se leksh
+    }
+}
+
+static void total_add(WordCounts *g, uint32_t hash, const char *word, uint64_t count) {
+    if (g->used * 2 >= g->cap) { // megalwnei sto miso, ksanavazw ola ta slots
+        WordCounts bigger = *g;
+        bigger.cap = g->cap ? g->cap * 2 : 4096;
+        bigger.used = 0;
+        bigger.slots = calloc(bigger.cap, sizeof(WordTotal));
+        if (!bigger.slots) {
+            perror("malloc failed for word counts");
+            exit(1);
+        }
+        for (unsigned i = 0; i < g->cap; i++) {
+            WordTotal *e = &g->slots[i];
+            if (e->hash) total_add(&bigger, e->hash, e->word, e->count);
+        }
+        free(g->slots);
+        *g = bigger;
+    }
+    for (unsigned i = hash_slot(hash, g->cap);; i = (i + 1) & (g->cap - 1)) {
+        WordTotal *e = &g->slots[i];
+        if (e->hash == hash && memcmp(e->word, word, WORD_MAX) == 0) {
+            e->count += count;
+            return;
+        }
+        if (e->hash == 0) {
+            e->hash = hash;
+            e->count = count;
+            memcpy(e->word, word, WORD_MAX);
+            g->used++;
+            return;
+        }
+    }
+}
+
+void word_counts_merge(WordCounts *g, const WordTable *t, unsigned slots) {
+    for (unsigned i = 0; i < slots; i++) {
+        const WordEntry *e = &t->entries[i];
+        if (e->hash) total_add(g, e->hash, e->word, e->count);
+    }
+    g->words += t->words;
+    g->dropped += t->dropped;
+    for (int c = 0; c < 256; c++) {
+        g->chars[c] += t->chars[c];
+    }
+}
+
+static int by_count(const void *a, const void *b) {
+    const WordTotal *x = *(const WordTotal *const *)a, *y = *(const WordTotal *const *)b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return strcmp(x->word, y->word);
+}
+
+typedef struct {
+    char letter;
+    unsigned long count;
+} LetterCount;
+
+static int by_letter_count(const void *a, const void *b) {
+    const LetterCount *x = a, *y = b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return x->letter - y->letter;
+}
+
+void word_counts_report(const WordCounts *g, int top_n) {
+    const WordTotal **sorted = malloc((g->used ? g->used : 1) * sizeof(WordTotal *));
+    if (!sorted) {
+        perror("malloc failed for word counts");
+        return;
+    }
+    unsigned n = 0;
+    for (unsigned i = 0; i < g->cap; i++) {
+        if (g->slots[i].hash) sorted[n++] = &g->slots[i];
+    }
+    qsort(sorted, n, sizeof(*sorted), by_count);
+    printf("WORDS kernel=%s words=%lu distinct=%u dropped=%lu\n", text_init(), g->words, n, g->dropped);
+    for (unsigned i = 0; i < n && i < (unsigned)top_n; i++) {
+        printf("%5u %-24s %llu\n", i + 1, sorted[i]->word, (unsigned long long)sorted[i]->count);
+    }
+    free(sorted);
+
+    // ta grammata xwris diafora kefalaiwn-mikrwn, se pososto olwn twn grammatwn
+    LetterCount letters[26];
+    unsigned long total = 0;
+    for (int l = 0; l < 26; l++) {
+        letters[l].letter = 'a' + l;
+        letters[l].count = g->chars['a' + l] + g->chars['A' + l];
+        total += letters[l].count;
+    }
+    qsort(letters, 26, sizeof(LetterCount), by_letter_count);
+    printf("LETTERS");
+    for (int l = 0; l < 26; l++) {
+        printf(" %c=%.2f%%", letters[l].letter, total ? 100.0 * letters[l].count / total : 0.0);
+    }
+    printf("\n");
+}
+
+void word_counts_free(WordCounts *g) {
+    free(g->slots);
+    memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,38 @@
+#ifndef TEXTSTAT_H
+#define TEXTSTAT_H
+
+#include "sharedmem.h"
+
+// dialegei ton classifier (AVX2, SSE2 h scalar) gia th CPU, mia fora ana diergasia.
+// Epistrefei to onoma tou
+const char *text_init(void);
+
+// metraei ta bytes kai tis lekseis enos mhnymatos ston pinaka tou paidiou.
+// Leksh einai kathe seira apo ASCII grammata kai pshfia, metrietai me mikra.
+// readable >= len: posa bytes apo to text epitrepetai na diavastoun (ws to telos tou corpus),
+// o classifier diavazei olokliro block kai meta to mhnyma
+void text_count(WordTable *t, unsigned slots, const char *text, size_t len, size_t readable);
+
+// o synolikos pinakas tou parent, megalwnei oso xreiazetai
+typedef struct {
+    uint64_t count;
+    uint32_t hash;        // 0 = adeio slot
+    char word[WORD_MAX];
+} WordTotal;
+
+typedef struct {
+    WordTotal *slots;
+    unsigned cap, used;   // to cap einai dunamh tou 2
+    unsigned long words, dropped;
+    unsigned long chars[256];
+} WordCounts;
+
+// prosthetei ton pinaka enos paidiou sta synola
+void word_counts_merge(WordCounts *g, const WordTable *t, unsigned slots);
+
+// typwnei tis top_n lekseis kai th syxnothta twn grammatwn
+void word_counts_report(const WordCounts *g, int top_n);
+
+void word_counts_free(WordCounts *g);
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sharedmem.h"
+
+static const char *event_names[TRACE_TYPES] = {
+    "SPAWN", "ENQUEUE", "WAKE", "WAKEUP", "DEQUEUE", "ACK", "CONTROL", "EXIT"
+};
+
+// ta mhnymata enos paidiou apo to ENQUEUE ws to ACK, me th seira ths ouras
+typedef struct {
+    uint64_t *pos, *enq, *deq;  // thesh sthn oura, pote mphke, pote to phre to paidi
+    size_t count, cap;
+    size_t deq_next;            // to prwto pou den exei ginei akoma DEQUEUE
+    size_t ack_next;            // to prwto pou den exei ginei akoma ACK
+} ChildTrack;
+
+// ena stadio tou mhnymatos gia th synopsh
+typedef struct {
+    const char *name;
+    unsigned long buckets[LAT_BUCKETS];
+    unsigned long count, max;
+    double sum;
+} Stage;
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s] <trace_file>\n", prog);
+    exit(1);
+}
+
+static int by_time(const void *a, const void *b) {
+    const TraceEvent *x = a, *y = b;
+    if (x->ns != y->ns) return x->ns < y->ns ? -1 : 1;
+    return x->type - y->type; // idia wra: me th seira pou pernaei to mhnyma
+}
+
+static void stage_add(Stage *s, uint64_t ns) {
+    s->buckets[lat_bucket(ns)]++;
+    s->count++;
+    s->sum += ns;
+    if (ns > s->max) s->max = ns;
+}
+
+static unsigned long stage_pct(const Stage *s, double pct) {
+    unsigned long seen = 0;
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += s->buckets[b];
+        if (seen >= pct * s->count) return lat_bucket_max(b) < s->max ? lat_bucket_max(b) : s->max;
+    }
+    return s->max;
+}
+
+static void track_enqueue(ChildTrack *t, uint64_t pos, uint64_t ns) {
+    if (t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 64;
+        t->pos = realloc(t->pos, t->cap * sizeof(uint64_t));
+        t->enq = realloc(t->enq, t->cap * sizeof(uint64_t));
+        t->deq = realloc(t->deq, t->cap * sizeof(uint64_t));
+        if (!t->pos || !t->enq || !t->deq) {
+            perror("malloc failed in tracedump");
+            exit(1);
+        }
+    }
+    t->pos[t->count] = pos;
+    t->enq[t->count] = ns;
+    t->count++;
+}
+
+// diavazei to arxeio tou parent -X, typwnei ta events se xronikh seira kai pou paei o xronos
+// apo to ENQUEUE ws to ACK kathe mhnymatos
+int main(int argc, char *argv[]) {
+    int summary_only = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "s")) != -1) {
+        switch (opt) {
+        case 's':
+            summary_only = 1;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+    }
+    FILE *in = fopen(argv[optind], "rb");
+    if (!in) {
+        perror("Failed to open trace file");
+        exit(1);
+    }
+    TraceHeader h;
+    if (fread(&h, sizeof(h), 1, in) != 1 || memcmp(h.magic, TRACE_MAGIC, 4) != 0 || h.version != TRACE_VERSION) {
+        fprintf(stderr, "%s is not a trace file from this version\n", argv[optind]);
+        exit(1);
+    }
+    TraceEvent *events = malloc((h.count ? h.count : 1) * sizeof(TraceEvent));
+    if (!events) {
+        perror("malloc failed in tracedump");
+        exit(1);
+    }
+    if (fread(events, sizeof(TraceEvent), h.count, in) != h.count) {
+        fprintf(stderr, "%s is truncated\n", argv[optind]);
+        exit(1);
+    }
+    fclose(in);
+    qsort(events, h.count, sizeof(TraceEvent), by_time); // ta rings grafontai ena ena, edw ginontai mia seira
+
+    int max_child = -1;
+    for (uint64_t i = 0; i < h.count; i++) {
+        if (events[i].child > max_child) max_child = events[i].child;
+    }
+    ChildTrack *tracks = calloc(max_child + 1, sizeof(ChildTrack));
+    Stage stages[3] = { { .name = "enqueue->dequeue" }, { .name = "dequeue->ack" }, { .name = "enqueue->ack" } };
+    if (!tracks) {
+        perror("malloc failed in tracedump");
+        exit(1);
+    }
+
+    if (!summary_only) {
+        printf("%14s %10s %5s %-10s %6s %s\n", "time_us", "delta_us", "who", "event", "child", "arg");
+    }
+    for (uint64_t i = 0; i < h.count; i++) {
+        TraceEvent *e = &events[i];
+        if (e->type >= TRACE_TYPES || e->child < 0) continue; // event pou grafotan thn wra tou dump
+        if (!summary_only) {
+            char who[16];
+            if (e->source < 0) snprintf(who, sizeof(who), "C%d", e->child + 1);
+            else snprintf(who, sizeof(who), "D%d", e->source);
+            printf("%14.3f %10.3f %5s %-10s %6d %llu\n", (e->ns - events[0].ns) / 1e3,
+                   i > 0 ? (e->ns - events[i - 1].ns) / 1e3 : 0.0, who, event_names[e->type],
+                   e->child + 1, (unsigned long long)e->arg);
+        }
+
+        ChildTrack *t = &tracks[e->child];
+        switch (e->type) {
+        case TRACE_ENQUEUE:
+            track_enqueue(t, e->arg, e->ns);
+            break;
+        case TRACE_DEQUEUE: // to arg einai apokleistiko orio
+            while (t->deq_next < t->count && t->pos[t->deq_next] < e->arg) {
+                t->deq[t->deq_next++] = e->ns;
+            }
+            break;
+        case TRACE_ACK:
+            while (t->ack_next < t->deq_next && t->pos[t->ack_next] < e->arg) {
+                size_t m = t->ack_next++;
+                stage_add(&stages[0], t->deq[m] - t->enq[m]);
+                stage_add(&stages[1], e->ns - t->deq[m]);
+                stage_add(&stages[2], e->ns - t->enq[m]);
+            }
+            break;
+        case TRACE_EXIT: // osa emeinan sthn oura den tha ginoun pote ACK
+            t->deq_next = t->ack_next = t->count;
+            break;
+        }
+    }
+
+    printf("TRACE events=%llu dropped=%llu span_us=%.3f\n", (unsigned long long)h.count,
+           (unsigned long long)h.dropped, h.count ? (events[h.count - 1].ns - events[0].ns) / 1e3 : 0.0);
+    for (int s = 0; s < 3; s++) {
+        Stage *st = &stages[s];
+        printf("%-17s messages=%lu mean_ns=%.0f p50_ns=%lu p99_ns=%lu max_ns=%lu\n", st->name, st->count,
+               st->count ? st->sum / st->count : 0.0, stage_pct(st, 0.50), stage_pct(st, 0.99), st->max);
+    }
+
+    for (int c = 0; c <= max_child; c++) {
+        free(tracks[c].pos);
+        free(tracks[c].enq);
+        free(tracks[c].deq);
+    }
+    free(tracks);
+    free(events);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "worker.h"
+#include "textstat.h"
+
+// ta counters tou telemetry ta grafei mono to paidi, ara xwris atomic RMW
+static inline void stat_add(atomic_ulong *counter, unsigned long n) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// exei kati gia mena: entolh, mhnyma (an ta pairnw twra) h broadcast shutdown
+static int has_work(SharedMemory *shm_ptr, ChildQueue *q, int want_data) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned ctrl_tail = atomic_load_explicit(&q->ctrl_tail, memory_order_relaxed);
+    return atomic_load(&q->ctrl_head) != ctrl_tail || (want_data && atomic_load(&q->head) != tail) ||
+           atomic_load(&shm_ptr->shutdown);
+}
+
+// perimenw mexri na exw douleia. O parent ksypnaei meta apo kathe dhmosieush (sto doorbell mode
+// mono an koimamai), ara ena ksypnhma mporei na einai palio kai ksanaelegxw sto loop
+static void wait_for_work(SharedMemory *shm_ptr, ChildControl *me, sem_t *sem_child, int want_data) {
+    ChildQueue *q = &me->queue;
+    int child_index = me - shm_ptr->children; // to ring mou sto trace
+    while (!has_work(shm_ptr, q, want_data)) {
+        unsigned bell = atomic_load(&q->doorbell);
+        atomic_store(&q->child_sleeping, 1);
+        if (has_work(shm_ptr, q, want_data)) { // o parent mporei na egrapse prin dei to child_sleeping
+            atomic_store(&q->child_sleeping, 0);
+            break;
+        }
+        int slept; // wakeup metraei mono otan koimhthke pragmatika
+        if (shm_ptr->transport == TRANSPORT_FUTEX) {
+            slept = futex_wait(&q->doorbell, bell) == 0; // an o parent prolave na xtuphsei, epistrefei amesws
+        } else if (sem_trywait(sem_child) == 0) {
+            slept = 0; // xwris -b o parent kanei post gia kathe mhnyma, ena palio post den einai ksypnhma
+        } else {
+            slept = sem_wait(sem_child) == 0; // perimenw mexri na kanei post o parent
+        }
+        atomic_store(&q->child_sleeping, 0);
+        if (slept) {
+            stat_add(&me->wakeups, 1);
+            trace_event(shm_ptr, child_index, TRACE_WAKEUP, child_index, 0);
+        }
+    }
+}
+
+// epistrefw ta credits: to cumulative ACK ws th thesh pos ths ouras
+static void return_credits(SharedMemory *shm_ptr, int child_index, unsigned acked, unsigned pos) {
+    atomic_store(&shm_ptr->children[child_index].queue.acked, acked); // ena ACK gia ola osa perimenan
+    trace_event(shm_ptr, child_index, TRACE_ACK, child_index, pos);
+    notify_parent(shm_ptr, child_index);
+}
+
+void run_worker(const WorkerArgs *w) {
+    SharedMemory *shm_ptr = w->shm;
+    int child_index = w->child_index;
+    ChildControl *me = &shm_ptr->children[child_index]; // to block mou
+    int timing = shm_ptr->timing;
+
+    int messages_processed = 0;  // counter gia ta mhnmata pou ekane process
+    int start_step = me->start_step; // start step apo thn shared memory
+
+    ChildQueue *q = &me->queue; // h oura mou
+    // parent -A: metraw tis lekseis kathe mhnymatos prin to ACK
+    WordTable *words = shm_ptr->analytics ? shm_word_table(shm_ptr, child_index) : NULL;
+    unsigned word_slots = shm_ptr->word_slots;
+    if (words) {
+        text_init();
+    }
+    int batch = shm_ptr->batch;
+    // ta credits epistrefontai ana credit_batch mhnymata h otan adeiasei h oura,
+    // etsi o parent den perimenei pote credits pou krataei ena paidi pou koimatai
+    unsigned credit_batch = q->credits / 4 > 0 ? q->credits / 4 : 1;
+    unsigned acked = atomic_load_explicit(&q->acked, memory_order_relaxed);
+    unsigned unreturned = 0;
+    int paused = 0;      // CTRL_PAUSE: den pairnw mhnymata
+    int drain_step = -1; // CTRL_DRAIN: termatizw sto step auto molis adeiasei h oura
+    int end_step = -1;   // >= 0 otan prepei na termatisw
+    while (end_step < 0) {
+        wait_for_work(shm_ptr, me, w->sem_child, !paused);
+
+        // prwta to control lane, oso vathia kai na einai h oura twn mhnymatwn
+        unsigned ctrl_tail = atomic_load_explicit(&q->ctrl_tail, memory_order_relaxed);
+        while (end_step < 0 && atomic_load(&q->ctrl_head) != ctrl_tail) {
+            CtrlSlot cmd = q->ctrl[ctrl_tail & (CTRL_SLOTS - 1)];
+            atomic_store(&q->ctrl_tail, ++ctrl_tail);
+            switch (cmd.op) {
+            case CTRL_DRAIN:
+                drain_step = cmd.arg;
+                paused = 0;
+                break;
+            case CTRL_KILL: {
+                // ta mhnymata pou perimenoun den ginontai process, ta credits omws epistrefontai
+                unsigned head = atomic_load(&q->head);
+                unsigned dropped = head - atomic_load_explicit(&q->tail, memory_order_relaxed);
+                atomic_store(&q->tail, head);
+                acked += dropped;
+                unreturned += dropped;
+                end_step = cmd.arg;
+                break;
+            }
+            case CTRL_PAUSE:
+                paused = 1;
+                break;
+            case CTRL_RESUME:
+                paused = 0;
+                break;
+            case CTRL_CREDITS:
+                credit_batch = cmd.arg / 4 > 0 ? cmd.arg / 4 : 1;
+                break;
+            }
+        }
+
+        unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        unsigned avail = atomic_load(&q->head) - tail;
+        if (end_step < 0 && !paused && avail > 0) {
+            unsigned long woke = timing ? now_ns() : 0;
+            // se batch mode pairnw ola osa perimenoun, alliws ena
+            unsigned count = batch ? avail : 1;
+            RingSlot msgs[RING_SLOTS];
+            for (unsigned i = 0; i < count; i++) {
+                msgs[i] = *queue_slot(q, tail + i); // antigrafw mono ton descriptor, oxi to keimeno
+            }
+            tail += count;
+            atomic_store(&q->tail, tail); // eleutherwnw ola ta slots mazi
+            trace_event(shm_ptr, child_index, TRACE_DEQUEUE, child_index, tail);
+            notify_parent(shm_ptr, child_index); // o parent perimenei xwro, ton ksypnaw
+
+            size_t batch_bytes = 0;
+            for (unsigned i = 0; i < count; i++) {
+                //  kanoniko mhnuma, auksanw to counter twn mhnymatwn pou ekane process
+                batch_bytes += msgs[i].length; // h grammh einai sto corpus + offset, xwris antigrafh
+                if (words) {
+                    text_count(words, word_slots, w->corpus + msgs[i].offset, msgs[i].length,
+                               w->corpus_size - msgs[i].offset);
+                }
+            }
+            messages_processed += count;
+            stat_add(&me->messages, count);
+            stat_add(&me->bytes, batch_bytes);
+            if (timing) {
+                unsigned long now = now_ns();
+                stat_add(&me->busy_ns, now - woke);
+                for (unsigned i = 0; i < count; i++) {
+                    me->latency[lat_bucket(now - msgs[i].enqueue_ns)]++; // dispatch-to-ACK
+                }
+            }
+            acked += count;
+            unreturned += count;
+        }
+
+        int empty = atomic_load(&q->head) == tail;
+        if (end_step < 0 && empty && drain_step >= 0) {
+            end_step = drain_step; // phra terminate kai teleiwsa osa eixa
+        } else if (end_step < 0 && atomic_load(&shm_ptr->shutdown)) {
+            if (empty) {
+                end_step = shm_ptr->shutdown_step; // broadcast EXIT apo ton parent
+            } else {
+                paused = 0; // to EXIT teleiwnei oti exei sthn oura, akoma kai se PAUSE
+            }
+        }
+        if (unreturned > 0 && (unreturned >= credit_batch || empty || paused || end_step >= 0)) {
+            return_credits(shm_ptr, child_index, acked, atomic_load_explicit(&q->tail, memory_order_relaxed));
+            unreturned = 0;
+        }
+    }
+
+    int total_active_steps = end_step - start_step; // posa steps htan active
+    if (w->thread) {
+        printf("Child TID %ld processed %d messages and was active for %d steps before termination.\n",
+               (long)syscall(SYS_gettid), messages_processed, total_active_steps);
+    } else {
+        printf("Child PID %d processed %d messages and was active for %d steps before termination.\n",
+               getpid(), messages_processed, total_active_steps);
+    }
+}
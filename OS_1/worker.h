@@ -0,0 +1,21 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <semaphore.h>
+
+#include "sharedmem.h"
+
+// oti xreiazetai ena logiko paidi, eite trexei san process (child.c) eite san thread mesa ston parent
+typedef struct {
+    SharedMemory *shm;
+    sem_t *sem_child;     // NULL sto futex transport
+    const char *corpus;   // ta mhnymata einai descriptors mesa se auto
+    size_t corpus_size;   // to text_count diavazei ws edw
+    int child_index;
+    int thread;           // 1 an trexei san thread tou parent
+} WorkerArgs;
+
+// to loop tou paidiou mexri to TERMINATE h to broadcast EXIT, typwnei ta stats tou sto telos
+void run_worker(const WorkerArgs *w);
+
+#endif